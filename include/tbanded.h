@@ -0,0 +1,325 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Ленточная матрица, ленточное LU-разложение и метод прогонки
+
+#ifndef __TBanded_H__
+#define __TBanded_H__
+
+#include <cmath>
+#include <vector>
+#include "tmatrix.h"
+
+// Ленточная матрица n x n: ненулевыми могут быть только элементы
+// i - kl <= j <= i + ku (kl поддиагоналей, ku наддиагоналей).
+// Хранится по строкам, kl + ku + 1 элементов на строку: n(kl + ku + 1) вместо n^2.
+// Строки у краев матрицы дополняются нулями, которые не относятся к матрице.
+// Размер ограничен MAX_VECTOR_SIZE
+template<typename T, typename Alloc = TAlignedAllocator<T>>
+class TBandMatrix : public TMatExpr<TBandMatrix<T, Alloc>>
+{
+  size_t sz, kl, ku;
+  TDynamicVector<T, Alloc> elems;
+
+  static size_t check_size(size_t s, size_t l, size_t u)
+  {
+    if (s == 0)
+      throw out_of_range("Matrix size should be greater than zero");
+    if (s > MAX_VECTOR_SIZE)
+      throw out_of_range("Matrix size should not exceed MAX_VECTOR_SIZE");
+    if (l >= s || u >= s)
+      throw out_of_range("Bandwidth should be less than matrix size");
+    return s;
+  }
+  static size_t band_size(size_t s, size_t l, size_t u)
+  {
+    if (s > MAX_VECTOR_SIZE / (l + u + 1))
+      throw out_of_range("Band should not exceed MAX_VECTOR_SIZE elements");
+    return s * (l + u + 1);
+  }
+  void check_band(const TBandMatrix& m) const
+  {
+    if (sz != m.sz || kl != m.kl || ku != m.ku)
+      throw length_error("Matrices should have equal sizes and bandwidths");
+  }
+public:
+  typedef T value_type;
+  typedef TDynamicMatrix<T> matrix_type;
+  typedef Alloc allocator_type;
+
+  TBandMatrix(size_t s, size_t l, size_t u, const Alloc& a = Alloc())
+    : sz(check_size(s, l, u)), kl(l), ku(u), elems(band_size(s, l, u), a)
+  {
+  }
+  // элементы не инициализируются
+  TBandMatrix(size_t s, size_t l, size_t u, TUninitialized, const Alloc& a = Alloc())
+    : sz(check_size(s, l, u)), kl(l), ku(u), elems(band_size(s, l, u), uninitialized, a)
+  {
+    // дополнение у краев должно оставаться нулевым
+    for (size_t i = 0; i < std::min(sz, kl); i++)
+      std::fill((*this)[i] + i - kl, (*this)[i], T());
+    for (size_t i = sz > ku ? sz - ku : 0; i < sz; i++)
+      std::fill((*this)[i] + sz, (*this)[i] + i + ku + 1, T());
+  }
+  // лента квадратного выражения, элементы вне ленты отбрасываются
+  template<typename E>
+  TBandMatrix(const TMatExpr<E>& expr, size_t l, size_t u, const Alloc& a = Alloc())
+    : sz(check_size(expr.self().rows(), l, u)), kl(l), ku(u), elems(band_size(sz, l, u), a)
+  {
+    const E& e = expr.self();
+    if (e.rows() != e.cols())
+      throw length_error("Banded matrix requires a square matrix");
+    for (size_t i = 0; i < sz; i++)
+      for (size_t j = first(i); j <= last(i); j++)
+        (*this)[i][j] = e(i, j);
+  }
+
+  size_t size() const noexcept { return sz; }
+  size_t rows() const noexcept { return sz; }
+  size_t cols() const noexcept { return sz; }
+  size_t lower() const noexcept { return kl; }
+  size_t upper() const noexcept { return ku; }
+  Alloc get_allocator() const { return elems.get_allocator(); }
+
+  // столбцы ленты в строке i: [first(i), last(i)]
+  size_t first(size_t i) const noexcept { return i > kl ? i - kl : 0; }
+  size_t last(size_t i) const noexcept { return std::min(sz - 1, i + ku); }
+
+  // m[i][j] - элемент, только для j из [first(i), last(i)];
+  // указатель сдвинут так, что к элементу (i, j) обращаются по индексу j
+  T* operator[](size_t i) { return elems.data() + i * (kl + ku) + kl; }
+  const T* operator[](size_t i) const { return elems.data() + i * (kl + ku) + kl; }
+
+  // индексация с контролем; элементы вне ленты равны нулю и не изменяются
+  T& at(size_t i, size_t j)
+  {
+    if (i >= sz || j >= sz)
+      throw out_of_range("Matrix index is out of range");
+    if (j < first(i) || j > last(i))
+      throw out_of_range("Element outside the band is not stored");
+    return (*this)[i][j];
+  }
+  T at(size_t i, size_t j) const
+  {
+    if (i >= sz || j >= sz)
+      throw out_of_range("Matrix index is out of range");
+    return (*this)(i, j);
+  }
+
+  // интерфейс матричного выражения
+  T operator()(size_t i, size_t j) const { return j < first(i) || j > last(i) ? T() : (*this)[i][j]; }
+  const T* row_data(size_t) const noexcept { return nullptr; }
+  void eval_row(size_t i, size_t j0, size_t n, T* out) const
+  {
+    std::fill(out, out + n, T());
+    size_t j1 = std::min(j0 + n, last(i) + 1);
+    for (size_t j = std::max(j0, first(i)); j < j1; j++)
+      out[j - j0] = (*this)[i][j];
+  }
+  template<typename M>
+  void eval_to(M& m) const { mat_assign(*this, m); }
+
+  // сравнение
+  bool operator==(const TBandMatrix& m) const noexcept
+  {
+    return sz == m.sz && kl == m.kl && ku == m.ku && elems == m.elems;
+  }
+  bool operator!=(const TBandMatrix& m) const noexcept
+  {
+    return !(*this == m);
+  }
+
+  // обновление на месте - по хранимой ленте
+  TBandMatrix& operator+=(const TBandMatrix& m)
+  {
+    check_band(m);
+    elems += m.elems;
+    return *this;
+  }
+  TBandMatrix& operator-=(const TBandMatrix& m)
+  {
+    check_band(m);
+    elems -= m.elems;
+    return *this;
+  }
+  TBandMatrix& operator*=(const T& val)
+  {
+    elems *= val;
+    return *this;
+  }
+
+  friend void swap(TBandMatrix& lhs, TBandMatrix& rhs) noexcept
+  {
+    std::swap(lhs.sz, rhs.sz);
+    std::swap(lhs.kl, rhs.kl);
+    std::swap(lhs.ku, rhs.ku);
+    swap(lhs.elems, rhs.elems);
+  }
+
+  // ввод - элементы ленты по строкам, вывод - вся матрица
+  friend istream& operator>>(istream& istr, TBandMatrix& v)
+  {
+    for (size_t i = 0; i < v.sz; i++)
+      for (size_t j = v.first(i); j <= v.last(i); j++)
+        istr >> v[i][j];
+    return istr;
+  }
+  friend ostream& operator<<(ostream& ostr, const TBandMatrix& v)
+  {
+    for (size_t i = 0; i < v.sz; i++)
+    {
+      for (size_t j = 0; j < v.sz; j++)
+        ostr << v(i, j) << ' ';
+      ostr << endl;
+    }
+    return ostr;
+  }
+};
+
+template<typename T, typename A>
+TBandMatrix<T, A> operator+(TBandMatrix<T, A> a, const TBandMatrix<T, A>& b)
+{
+  a += b;
+  return a;
+}
+template<typename T, typename A>
+TBandMatrix<T, A> operator-(TBandMatrix<T, A> a, const TBandMatrix<T, A>& b)
+{
+  a -= b;
+  return a;
+}
+template<typename T, typename A>
+TBandMatrix<T, A> operator*(TBandMatrix<T, A> a, typename TBandMatrix<T, A>::value_type val)
+{
+  a *= val;
+  return a;
+}
+template<typename T, typename A>
+TBandMatrix<T, A> operator*(typename TBandMatrix<T, A>::value_type val, TBandMatrix<T, A> a)
+{
+  a *= val;
+  return a;
+}
+
+// Умножение на вектор: y(i) - скалярное произведение ленты строки i, O(n(kl + ku))
+template<typename T, typename A, typename V>
+TDynamicVector<T, A> operator*(const TBandMatrix<T, A>& a, const TVecExpr<V>& b)
+{
+  const V& x = b.self();
+  size_t n = a.size();
+  if (n != x.size())
+    throw length_error("Vector size should be equal to matrix column count");
+  std::unique_ptr<TDynamicVector<T>> tmp;
+  const T* px = x.data();
+  if (px == nullptr)
+  {
+    tmp.reset(new TDynamicVector<T>(x));
+    px = tmp->data();
+  }
+  TDynamicVector<T, A> res(n, uninitialized, a.get_allocator());
+  for (size_t i = 0; i < n; i++)
+  {
+    size_t j0 = a.first(i);
+    res[i] = simd::dot(a[i] + j0, px + j0, a.last(i) + 1 - j0);
+  }
+  return res;
+}
+
+// LU-разложение ленточной матрицы с выбором ведущего элемента по столбцу:
+// P * A = L * U, O(n * kl * (kl + ku)) операций.
+// Перестановки строк расширяют U до kl + ku наддиагоналей, поэтому множители
+// хранятся в ленте с kl поддиагоналями и kl + ku наддиагоналями. Как в LAPACK (gbtrf),
+// перестановки применяются только к еще не исключенной части строк,
+// а при решении - к правой части по шагам
+template<typename T, typename Alloc = TAlignedAllocator<T>>
+class TBandLU
+{
+  TBandMatrix<T, Alloc> f;
+  std::vector<size_t> piv;
+public:
+  explicit TBandLU(const TBandMatrix<T, Alloc>& a)
+    : f(a.size(), a.lower(), std::min(a.size() - 1, a.lower() + a.upper()), a.get_allocator()), piv(a.size())
+  {
+    size_t n = a.size(), kl = a.lower();
+    for (size_t i = 0; i < n; i++)
+      std::copy(a[i] + a.first(i), a[i] + a.last(i) + 1, f[i] + a.first(i));
+    for (size_t i = 0; i < n; i++)
+    {
+      size_t r1 = std::min(n - 1, i + kl), j1 = f.last(i);
+      size_t p = i;
+      for (size_t r = i + 1; r <= r1; r++)
+        if (std::abs(f[r][i]) > std::abs(f[p][i]))
+          p = r;
+      piv[i] = p;
+      if (f[p][i] == T())
+        throw domain_error("Matrix is singular");
+      if (p != i)
+        std::swap_ranges(f[i] + i, f[i] + j1 + 1, f[p] + i);
+      T* ui = f[i];
+      for (size_t r = i + 1; r <= r1; r++)
+      {
+        T l = f[r][i] / ui[i];
+        f[r][i] = l;
+        simd::axpy(-l, ui + i + 1, f[r] + i + 1, j1 - i);
+      }
+    }
+  }
+
+  size_t size() const noexcept { return f.size(); }
+  // L (без единичной диагонали) под диагональю, U - на и над ней
+  const TBandMatrix<T, Alloc>& factors() const noexcept { return f; }
+  // piv[i] - строка, переставленная со строкой i на шаге i
+  const size_t* pivots() const noexcept { return piv.data(); }
+
+  // решение A * x = b
+  template<typename V>
+  TDynamicVector<T, Alloc> solve(const TVecExpr<V>& b) const
+  {
+    size_t n = f.size(), kl = f.lower();
+    if (n != b.self().size())
+      throw length_error("Right-hand side size should be equal to matrix size");
+    TDynamicVector<T, Alloc> x(b, f.get_allocator());
+    for (size_t i = 0; i < n; i++)
+    {
+      std::swap(x[i], x[piv[i]]);
+      for (size_t r = i + 1; r <= std::min(n - 1, i + kl); r++)
+        x[r] -= f[r][i] * x[i];
+    }
+    for (size_t i = n; i-- > 0;)
+      x[i] = (x[i] - simd::dot(f[i] + i + 1, x.data() + i + 1, f.last(i) - i)) / f[i][i];
+    return x;
+  }
+};
+
+// Метод прогонки (алгоритм Томаса) для трехдиагональной матрицы, O(n).
+// Без перестановок: устойчив для матриц с диагональным преобладанием;
+// нулевой знаменатель - исключение domain_error
+template<typename T, typename A, typename V>
+TDynamicVector<T, A> solve_tridiagonal(const TBandMatrix<T, A>& a, const TVecExpr<V>& d)
+{
+  size_t n = a.size();
+  if (a.lower() > 1 || a.upper() > 1)
+    throw length_error("Matrix should be tridiagonal");
+  if (n != d.self().size())
+    throw length_error("Right-hand side size should be equal to matrix size");
+  // прямой ход: c'(i) = c(i) / m(i), x(i) = (d(i) - a(i) x(i - 1)) / m(i),
+  // m(i) = b(i) - a(i) c'(i - 1)
+  TDynamicVector<T, A> x(d, a.get_allocator());
+  std::vector<T> cp(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    T sub = i > 0 && a.lower() > 0 ? a[i][i - 1] : T();
+    T m = a[i][i] - (i > 0 ? sub * cp[i - 1] : T());
+    if (m == T())
+      throw domain_error("Zero pivot in tridiagonal solver");
+    cp[i] = i + 1 < n && a.upper() > 0 ? a[i][i + 1] / m : T();
+    x[i] = (x[i] - (i > 0 ? sub * x[i - 1] : T())) / m;
+  }
+  // обратный ход
+  for (size_t i = n - 1; i-- > 0;)
+    x[i] -= cp[i] * x[i + 1];
+  return x;
+}
+
+#endif
@@ -0,0 +1,946 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Шаблоны выражений для отложенных вычислений над векторами и матрицами
+
+#ifndef __TExpr_H__
+#define __TExpr_H__
+
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include <type_traits>
+#include "tsimd.h"
+#include "tgemm.h"
+#include "tmemory.h"
+
+template<typename T, typename Alloc = TAlignedAllocator<T>> class TDynamicVector;
+template<typename T, typename Alloc = TAlignedAllocator<T>> class TRowStorage;
+template<typename T, typename Storage = TRowStorage<T>> class TDynamicMatrix;
+
+// Выражение вычисляется порциями по EXPR_CHUNK элементов:
+// промежуточные результаты порции лежат на стеке и не покидают L1,
+// вся цепочка операций проходит по памяти один раз
+const size_t EXPR_CHUNK = 256;
+
+// Базовый класс выражения (CRTP).
+// Выражение E предоставляет:
+//   value_type, size(), operator[](i) - значение элемента,
+//   data() - указатель на элементы в памяти или nullptr, если их нужно вычислять,
+//   eval(i0, n, out) - запись элементов [i0, i0 + n) в out, n <= EXPR_CHUNK
+template<typename E>
+class TVecExpr
+{
+public:
+  const E& self() const noexcept { return static_cast<const E&>(*this); }
+};
+
+// Вектор хранится в выражении по ссылке, вложенные выражения - по значению
+template<typename E> struct TExprOperand { typedef const E type; };
+template<typename T, typename A> struct TExprOperand<TDynamicVector<T, A>> { typedef const TDynamicVector<T, A>& type; };
+
+// Порция [i0, i0 + n) операнда: прямо из памяти вектора или вычисленная в tmp.
+// Результат узла пишется в out только последней операцией, поэтому out
+// может совпадать с памятью любого вектора из выражения
+template<typename E>
+const typename E::value_type* expr_chunk(const E& e, size_t i0, size_t n, typename E::value_type* tmp)
+{
+  const typename E::value_type* p = e.data();
+  if (p != nullptr)
+    return p + i0;
+  e.eval(i0, n, tmp);
+  return tmp;
+}
+
+// Операции над порцией элементов
+struct TExprAdd
+{
+  template<typename T> static T at(const T& a, const T& b) { return a + b; }
+  template<typename T> static void apply(const T* a, const T* b, T* r, size_t n) { simd::add(a, b, r, n); }
+};
+struct TExprSub
+{
+  template<typename T> static T at(const T& a, const T& b) { return a - b; }
+  template<typename T> static void apply(const T* a, const T* b, T* r, size_t n) { simd::sub(a, b, r, n); }
+};
+struct TExprAddScalar
+{
+  template<typename T> static T at(const T& a, const T& v) { return a + v; }
+  template<typename T> static void apply(const T* a, T v, T* r, size_t n) { simd::add_scalar(a, v, r, n); }
+};
+struct TExprSubScalar
+{
+  template<typename T> static T at(const T& a, const T& v) { return a - v; }
+  template<typename T> static void apply(const T* a, T v, T* r, size_t n) { simd::sub_scalar(a, v, r, n); }
+};
+struct TExprMulScalar
+{
+  template<typename T> static T at(const T& a, const T& v) { return a * v; }
+  template<typename T> static void apply(const T* a, T v, T* r, size_t n) { simd::mul_scalar(a, v, r, n); }
+};
+
+// Поэлементная операция над двумя выражениями
+template<typename Op, typename L, typename R>
+class TVecBinaryExpr : public TVecExpr<TVecBinaryExpr<Op, L, R>>
+{
+  typename TExprOperand<L>::type l;
+  typename TExprOperand<R>::type r;
+public:
+  typedef typename L::value_type value_type;
+
+  TVecBinaryExpr(const L& lhs, const R& rhs) : l(lhs), r(rhs)
+  {
+    if (l.size() != r.size())
+      throw std::length_error("Vectors should have equal sizes");
+  }
+
+  size_t size() const noexcept { return l.size(); }
+  value_type operator[](size_t i) const { return Op::at(l[i], r[i]); }
+  const value_type* data() const noexcept { return nullptr; }
+
+  void eval(size_t i0, size_t n, value_type* out) const
+  {
+    alignas(MEMORY_ALIGNMENT) value_type lt[EXPR_CHUNK], rt[EXPR_CHUNK];
+    Op::apply(expr_chunk(l, i0, n, lt), expr_chunk(r, i0, n, rt), out, n);
+  }
+};
+
+// Операция над выражением и скаляром
+template<typename Op, typename E>
+class TVecScalarExpr : public TVecExpr<TVecScalarExpr<Op, E>>
+{
+public:
+  typedef typename E::value_type value_type;
+private:
+  typename TExprOperand<E>::type e;
+  value_type val;
+public:
+  TVecScalarExpr(const E& expr, const value_type& v) : e(expr), val(v) {}
+
+  const E& expr() const noexcept { return e; }
+  const value_type& scalar() const noexcept { return val; }
+
+  size_t size() const noexcept { return e.size(); }
+  value_type operator[](size_t i) const { return Op::at(e[i], val); }
+  const value_type* data() const noexcept { return nullptr; }
+
+  void eval(size_t i0, size_t n, value_type* out) const
+  {
+    alignas(MEMORY_ALIGNMENT) value_type et[EXPR_CHUNK];
+    Op::apply(expr_chunk(e, i0, n, et), val, out, n);
+  }
+};
+
+// Вычисление выражения в массив out размера e.size()
+template<typename E>
+void expr_assign(const TVecExpr<E>& expr, typename E::value_type* out)
+{
+  const E& e = expr.self();
+  size_t n = e.size();
+  for (size_t i = 0; i < n; i += EXPR_CHUNK)
+    e.eval(i, std::min(EXPR_CHUNK, n - i), out + i);
+}
+
+// out = out Op e - обновление на месте (Op - TExprAdd или TExprSub)
+template<typename Op, typename E>
+void expr_update(const TVecExpr<E>& expr, typename E::value_type* out)
+{
+  const E& e = expr.self();
+  size_t n = e.size();
+  alignas(MEMORY_ALIGNMENT) typename E::value_type tmp[EXPR_CHUNK];
+  for (size_t i = 0; i < n; i += EXPR_CHUNK)
+  {
+    size_t k = std::min(EXPR_CHUNK, n - i);
+    Op::apply(out + i, expr_chunk(e, i, k, tmp), out + i, k);
+  }
+}
+
+// out = alpha * e + out
+template<typename E>
+void expr_axpy(typename E::value_type alpha, const TVecExpr<E>& expr, typename E::value_type* out)
+{
+  const E& e = expr.self();
+  size_t n = e.size();
+  alignas(MEMORY_ALIGNMENT) typename E::value_type tmp[EXPR_CHUNK];
+  for (size_t i = 0; i < n; i += EXPR_CHUNK)
+  {
+    size_t k = std::min(EXPR_CHUNK, n - i);
+    simd::axpy(alpha, expr_chunk(e, i, k, tmp), out + i, k);
+  }
+}
+
+// векторные операции
+template<typename L, typename R>
+TVecBinaryExpr<TExprAdd, L, R> operator+(const TVecExpr<L>& a, const TVecExpr<R>& b)
+{
+  return TVecBinaryExpr<TExprAdd, L, R>(a.self(), b.self());
+}
+template<typename L, typename R>
+TVecBinaryExpr<TExprSub, L, R> operator-(const TVecExpr<L>& a, const TVecExpr<R>& b)
+{
+  return TVecBinaryExpr<TExprSub, L, R>(a.self(), b.self());
+}
+
+// скалярное произведение
+template<typename L, typename R>
+typename L::value_type operator*(const TVecExpr<L>& a, const TVecExpr<R>& b)
+{
+  typedef typename L::value_type T;
+  const L& l = a.self();
+  const R& r = b.self();
+  if (l.size() != r.size())
+    throw std::length_error("Vectors should have equal sizes");
+  if (l.data() != nullptr && r.data() != nullptr)
+    return simd::dot(l.data(), r.data(), l.size());
+  T res = T();
+  alignas(MEMORY_ALIGNMENT) T lt[EXPR_CHUNK], rt[EXPR_CHUNK];
+  for (size_t i = 0; i < l.size(); i += EXPR_CHUNK)
+  {
+    size_t n = std::min(EXPR_CHUNK, l.size() - i);
+    res += simd::dot(expr_chunk(l, i, n, lt), expr_chunk(r, i, n, rt), n);
+  }
+  return res;
+}
+
+// скалярные операции
+template<typename E>
+TVecScalarExpr<TExprAddScalar, E> operator+(const TVecExpr<E>& a, typename E::value_type val)
+{
+  return TVecScalarExpr<TExprAddScalar, E>(a.self(), val);
+}
+template<typename E>
+TVecScalarExpr<TExprSubScalar, E> operator-(const TVecExpr<E>& a, typename E::value_type val)
+{
+  return TVecScalarExpr<TExprSubScalar, E>(a.self(), val);
+}
+template<typename E>
+TVecScalarExpr<TExprMulScalar, E> operator*(const TVecExpr<E>& a, typename E::value_type val)
+{
+  return TVecScalarExpr<TExprMulScalar, E>(a.self(), val);
+}
+template<typename E>
+TVecScalarExpr<TExprMulScalar, E> operator*(typename E::value_type val, const TVecExpr<E>& a)
+{
+  return TVecScalarExpr<TExprMulScalar, E>(a.self(), val);
+}
+
+// Матричные выражения
+
+template<typename E> class TMatExprRow;
+
+// Базовый класс матричного выражения (CRTP).
+// Выражение E предоставляет:
+//   value_type, matrix_type - тип матрицы для промежуточных результатов,
+//   rows(), cols(), operator()(i, j) - значение элемента,
+//   row_data(i) - указатель на строку i в памяти или nullptr, если ее нужно вычислять,
+//   eval_row(i, j0, n, out) - запись элементов [j0, j0 + n) строки i в out, n <= EXPR_CHUNK,
+//   eval_to(m) - запись всего выражения в матрицу m того же размера rows() x cols()
+template<typename E>
+class TMatExpr
+{
+public:
+  const E& self() const noexcept { return static_cast<const E&>(*this); }
+  // e[i][j] - значение элемента
+  TMatExprRow<E> operator[](size_t i) const { return TMatExprRow<E>(self(), i); }
+};
+
+template<typename E>
+class TMatExprRow
+{
+  const E& e;
+  size_t i;
+public:
+  TMatExprRow(const E& expr, size_t ind) : e(expr), i(ind) {}
+  typename E::value_type operator[](size_t j) const { return e(i, j); }
+};
+
+template<typename T, typename S>
+struct TExprOperand<TDynamicMatrix<T, S>> { typedef const TDynamicMatrix<T, S>& type; };
+
+// Порция [j0, j0 + n) строки i операнда, аналог expr_chunk
+template<typename E>
+const typename E::value_type* mat_chunk(const E& e, size_t i, size_t j0, size_t n, typename E::value_type* tmp)
+{
+  const typename E::value_type* p = e.row_data(i);
+  if (p != nullptr)
+    return p + j0;
+  e.eval_row(i, j0, n, tmp);
+  return tmp;
+}
+
+// Поэлементное вычисление выражения в матрицу m
+template<typename E, typename M>
+void mat_assign(const E& e, M& m)
+{
+  size_t rn = e.rows(), n = e.cols();
+  for (size_t i = 0; i < rn; i++)
+  {
+    typename E::value_type* r = m.row_data(i);
+    for (size_t j = 0; j < n; j += EXPR_CHUNK)
+      e.eval_row(i, j, std::min(EXPR_CHUNK, n - j), r + j);
+  }
+}
+
+// m = m Op e - обновление на месте (Op - TExprAdd или TExprSub)
+template<typename Op, typename E, typename M>
+void mat_update(const E& e, M& m)
+{
+  size_t rn = e.rows(), n = e.cols();
+  alignas(MEMORY_ALIGNMENT) typename E::value_type tmp[EXPR_CHUNK];
+  for (size_t i = 0; i < rn; i++)
+  {
+    typename E::value_type* r = m.row_data(i);
+    for (size_t j = 0; j < n; j += EXPR_CHUNK)
+    {
+      size_t k = std::min(EXPR_CHUNK, n - j);
+      Op::apply(r + j, mat_chunk(e, i, j, k, tmp), r + j, k);
+    }
+  }
+}
+
+// m = alpha * e + m
+template<typename E, typename M>
+void mat_axpy(typename E::value_type alpha, const E& e, M& m)
+{
+  size_t rn = e.rows(), n = e.cols();
+  alignas(MEMORY_ALIGNMENT) typename E::value_type tmp[EXPR_CHUNK];
+  for (size_t i = 0; i < rn; i++)
+  {
+    typename E::value_type* r = m.row_data(i);
+    for (size_t j = 0; j < n; j += EXPR_CHUNK)
+    {
+      size_t k = std::min(EXPR_CHUNK, n - j);
+      simd::axpy(alpha, mat_chunk(e, i, j, k, tmp), r + j, k);
+    }
+  }
+}
+
+template<typename A, typename B>
+bool same_object(const A& a, const B& b) noexcept
+{
+  return static_cast<const void*>(&a) == static_cast<const void*>(&b);
+}
+
+// Значение выражения в виде матрицы:
+// матрица используется напрямую, выражение вычисляется во временную матрицу
+template<typename E>
+class TMatValue
+{
+  typedef typename E::matrix_type M;
+  std::unique_ptr<M> tmp;
+public:
+  typedef M type;
+
+  explicit TMatValue(const E& e) : tmp(new M(e)) {}
+  const M& get() const noexcept { return *tmp; }
+};
+template<typename T, typename S>
+class TMatValue<TDynamicMatrix<T, S>>
+{
+  const TDynamicMatrix<T, S>& m;
+public:
+  typedef TDynamicMatrix<T, S> type;
+
+  explicit TMatValue(const TDynamicMatrix<T, S>& matr) : m(matr) {}
+  const TDynamicMatrix<T, S>& get() const noexcept { return m; }
+};
+
+// Сомножитель произведения: матрица в памяти (TMatValue) и признак transposed -
+// транспонированная матрица (TMatTransposeExpr) не копируется,
+// ядра умножения читают ее в хранимом виде
+template<typename E>
+class TGemmOperand
+{
+  TMatValue<E> v;
+public:
+  typedef std::false_type transposed;
+
+  explicit TGemmOperand(const E& e) : v(e) {}
+  const typename TMatValue<E>::type& get() const noexcept { return v.get(); }
+  // размеры сомножителя op(a)
+  size_t rows() const noexcept { return v.get().rows(); }
+  size_t cols() const noexcept { return v.get().cols(); }
+};
+
+// c += alpha * op(a) * op(b) для малых размеров и нечисловых типов;
+// c - m x n, k - общая размерность сомножителей;
+// порядок циклов выбран так, чтобы внутренний цикл шел по строкам подряд
+template<typename T, typename MA, typename MB, typename MC>
+void mat_gemm_naive(T alpha, const MA& a, std::false_type, const MB& b, std::false_type, MC& c, size_t k)
+{
+  size_t m = c.rows(), n = c.cols();
+  for (size_t i = 0; i < m; i++)
+  {
+    T* r = c.row_data(i);
+    const T* ai = a.row_data(i);
+    for (size_t p = 0; p < k; p++)
+    {
+      const T aip = alpha * ai[p];
+      const T* bp = b.row_data(p);
+      for (size_t j = 0; j < n; j++)
+        r[j] += aip * bp[j];
+    }
+  }
+}
+// a^T * b: строка p матрицы a - столбец p множителя
+template<typename T, typename MA, typename MB, typename MC>
+void mat_gemm_naive(T alpha, const MA& a, std::true_type, const MB& b, std::false_type, MC& c, size_t k)
+{
+  size_t m = c.rows(), n = c.cols();
+  for (size_t p = 0; p < k; p++)
+  {
+    const T* ap = a.row_data(p);
+    const T* bp = b.row_data(p);
+    for (size_t i = 0; i < m; i++)
+    {
+      T* r = c.row_data(i);
+      const T api = alpha * ap[i];
+      for (size_t j = 0; j < n; j++)
+        r[j] += api * bp[j];
+    }
+  }
+}
+// a * b^T: элемент - скалярное произведение строк
+template<typename T, typename MA, typename MB, typename MC>
+void mat_gemm_naive(T alpha, const MA& a, std::false_type, const MB& b, std::true_type, MC& c, size_t k)
+{
+  size_t m = c.rows(), n = c.cols();
+  for (size_t i = 0; i < m; i++)
+  {
+    T* r = c.row_data(i);
+    const T* ai = a.row_data(i);
+    for (size_t j = 0; j < n; j++)
+    {
+      const T* bj = b.row_data(j);
+      T sum = T();
+      for (size_t p = 0; p < k; p++)
+        sum += ai[p] * bj[p];
+      r[j] += alpha * sum;
+    }
+  }
+}
+// a^T * b^T = (b * a)^T
+template<typename T, typename MA, typename MB, typename MC>
+void mat_gemm_naive(T alpha, const MA& a, std::true_type, const MB& b, std::true_type, MC& c, size_t k)
+{
+  size_t m = c.rows(), n = c.cols();
+  for (size_t j = 0; j < n; j++)
+  {
+    const T* bj = b.row_data(j);
+    for (size_t p = 0; p < k; p++)
+    {
+      const T bjp = alpha * bj[p];
+      const T* ap = a.row_data(p);
+      for (size_t i = 0; i < m; i++)
+        c.row_data(i)[j] += ap[i] * bjp;
+    }
+  }
+}
+
+// строки сомножителя для gemm
+template<typename Row>
+Row gemm_rows(Row x, std::false_type) { return x; }
+template<typename Row>
+gemm_detail::TTransposed<Row> gemm_rows(Row x, std::true_type) { return gemm_transposed(x); }
+
+// c = alpha * op(a) * op(b) + beta * c, a и b - TGemmOperand;
+// простой алгоритм для малых размеров и нечисловых типов
+template<typename T, typename OA, typename OB, typename MC>
+void mat_gemm(T alpha, const OA& a, const OB& b, T beta, MC& c, std::false_type)
+{
+  size_t m = c.rows(), n = c.cols();
+  for (size_t i = 0; i < m; i++)
+  {
+    T* r = c.row_data(i);
+    if (beta == T())
+      std::fill(r, r + n, T());
+    else if (beta != T(1))
+      for (size_t j = 0; j < n; j++)
+        r[j] = r[j] * beta;
+  }
+  mat_gemm_naive(alpha, a.get(), typename OA::transposed(), b.get(), typename OB::transposed(), c, a.cols());
+}
+// для больших матриц - блочный алгоритм с упаковкой,
+// распределенный по потокам общего пула
+template<typename T, typename OA, typename OB, typename MC>
+void mat_gemm(T alpha, const OA& a, const OB& b, T beta, MC& c, std::true_type)
+{
+  size_t m = c.rows(), n = c.cols(), k = a.cols();
+  if (std::min(m, std::min(n, k)) < GEMM_BLOCKED_THRESHOLD)
+  {
+    mat_gemm(alpha, a, b, beta, c, std::false_type());
+    return;
+  }
+  // c.row_data вызывается из рабочих потоков: разделяемая память
+  // приемника (TSharedStorage) копируется заранее, в вызывающем потоке
+  c.row_data(0);
+  const typename OA::transposed ta = typename OA::transposed();
+  const typename OB::transposed tb = typename OB::transposed();
+  const auto& ma = a.get();
+  const auto& mb = b.get();
+  gemm_parallel(m, n, k, alpha,
+    gemm_rows([&ma](size_t i) { return ma.row_data(i); }, ta),
+    gemm_rows([&mb](size_t i) { return mb.row_data(i); }, tb),
+    beta,
+    [&c](size_t i) { return c.row_data(i); });
+}
+
+// Транспонирование без учета размеров кэша (cache-oblivious):
+// прямоугольник [i0, i1) x [j0, j1) приемника делится пополам по длинной стороне,
+// пока не станет меньше TRANSPOSE_BLOCK x TRANSPOSE_BLOCK; на каждом уровне
+// кэша найдется размер, при котором блоки источника и приемника в нем помещаются
+const size_t TRANSPOSE_BLOCK = 32;
+
+template<typename MA, typename M>
+void mat_transpose(const MA& a, M& m, size_t i0, size_t i1, size_t j0, size_t j1)
+{
+  if (i1 - i0 <= TRANSPOSE_BLOCK && j1 - j0 <= TRANSPOSE_BLOCK)
+  {
+    for (size_t i = i0; i < i1; i++)
+    {
+      typename MA::value_type* r = m.row_data(i);
+      for (size_t j = j0; j < j1; j++)
+        r[j] = a.row_data(j)[i];
+    }
+  }
+  else if (i1 - i0 >= j1 - j0)
+  {
+    size_t im = i0 + (i1 - i0) / 2;
+    mat_transpose(a, m, i0, im, j0, j1);
+    mat_transpose(a, m, im, i1, j0, j1);
+  }
+  else
+  {
+    size_t jm = j0 + (j1 - j0) / 2;
+    mat_transpose(a, m, i0, i1, j0, jm);
+    mat_transpose(a, m, i0, i1, jm, j1);
+  }
+}
+// m = a^T, a - r x c, m - c x r
+template<typename MA, typename M>
+void mat_transpose(const MA& a, M& m)
+{
+  mat_transpose(a, m, 0, a.cols(), 0, a.rows());
+}
+
+// Транспонирование на месте: обмен блока [i0, i1) x [j0, j1),
+// лежащего под диагональю, с симметричным ему блоком
+template<typename M>
+void mat_transpose_swap(M& m, size_t i0, size_t i1, size_t j0, size_t j1)
+{
+  if (j0 >= i1)
+    return;
+  if (i1 - i0 <= TRANSPOSE_BLOCK && j1 - j0 <= TRANSPOSE_BLOCK)
+  {
+    for (size_t i = i0; i < i1; i++)
+    {
+      typename M::value_type* r = m.row_data(i);
+      // на диагонали обрабатывается только нижний треугольник
+      size_t je = std::min(j1, i);
+      for (size_t j = j0; j < je; j++)
+        std::swap(r[j], m.row_data(j)[i]);
+    }
+  }
+  else if (i1 - i0 >= j1 - j0)
+  {
+    size_t im = i0 + (i1 - i0) / 2;
+    mat_transpose_swap(m, i0, im, j0, j1);
+    mat_transpose_swap(m, im, i1, j0, j1);
+  }
+  else
+  {
+    size_t jm = j0 + (j1 - j0) / 2;
+    mat_transpose_swap(m, i0, i1, j0, jm);
+    mat_transpose_swap(m, i0, i1, jm, j1);
+  }
+}
+// m = m^T без дополнительной памяти, m - квадратная
+template<typename M>
+void mat_transpose_inplace(M& m)
+{
+  mat_transpose_swap(m, 0, m.rows(), 0, m.cols());
+}
+
+// Поэлементная операция над двумя матричными выражениями
+template<typename Op, typename L, typename R>
+class TMatBinaryExpr : public TMatExpr<TMatBinaryExpr<Op, L, R>>
+{
+  typename TExprOperand<L>::type l;
+  typename TExprOperand<R>::type r;
+public:
+  typedef typename L::value_type value_type;
+  typedef typename L::matrix_type matrix_type;
+
+  TMatBinaryExpr(const L& lhs, const R& rhs) : l(lhs), r(rhs)
+  {
+    if (l.rows() != r.rows() || l.cols() != r.cols())
+      throw std::length_error("Matrices should have equal sizes");
+  }
+
+  size_t rows() const noexcept { return l.rows(); }
+  size_t cols() const noexcept { return l.cols(); }
+  value_type operator()(size_t i, size_t j) const { return Op::at(l(i, j), r(i, j)); }
+  const value_type* row_data(size_t) const noexcept { return nullptr; }
+
+  void eval_row(size_t i, size_t j0, size_t n, value_type* out) const
+  {
+    alignas(MEMORY_ALIGNMENT) value_type lt[EXPR_CHUNK], rt[EXPR_CHUNK];
+    Op::apply(mat_chunk(l, i, j0, n, lt), mat_chunk(r, i, j0, n, rt), out, n);
+  }
+  template<typename M>
+  void eval_to(M& m) const { mat_assign(*this, m); }
+};
+
+// Операция над матричным выражением и скаляром
+template<typename Op, typename E>
+class TMatScalarExpr : public TMatExpr<TMatScalarExpr<Op, E>>
+{
+public:
+  typedef typename E::value_type value_type;
+  typedef typename E::matrix_type matrix_type;
+private:
+  typename TExprOperand<E>::type e;
+  value_type val;
+public:
+  TMatScalarExpr(const E& expr, const value_type& v) : e(expr), val(v) {}
+
+  const E& expr() const noexcept { return e; }
+  const value_type& scalar() const noexcept { return val; }
+
+  size_t rows() const noexcept { return e.rows(); }
+  size_t cols() const noexcept { return e.cols(); }
+  value_type operator()(size_t i, size_t j) const { return Op::at(e(i, j), val); }
+  const value_type* row_data(size_t) const noexcept { return nullptr; }
+
+  void eval_row(size_t i, size_t j0, size_t n, value_type* out) const
+  {
+    alignas(MEMORY_ALIGNMENT) value_type et[EXPR_CHUNK];
+    Op::apply(mat_chunk(e, i, j0, n, et), val, out, n);
+  }
+  template<typename M>
+  void eval_to(M& m) const { mat_assign(*this, m); }
+};
+
+// Выражение, которое нельзя вычислить по строкам (произведение, транспонирование).
+// При присваивании матрице E::eval_to пишет результат прямо в нее,
+// внутри поэлементного выражения значение один раз вычисляется во временную матрицу
+template<typename E, typename M>
+class TMatCachedExpr : public TMatExpr<E>
+{
+  mutable std::shared_ptr<M> cache;
+protected:
+  const M& value() const
+  {
+    if (!cache)
+    {
+      std::shared_ptr<M> m = std::make_shared<M>(this->self().rows(), this->self().cols(), uninitialized);
+      this->self().eval_to(*m);
+      cache = m;
+    }
+    return *cache;
+  }
+public:
+  typedef typename M::value_type value_type;
+  typedef M matrix_type;
+
+  value_type operator()(size_t i, size_t j) const { return value()(i, j); }
+  const value_type* row_data(size_t i) const { return value().row_data(i); }
+  void eval_row(size_t i, size_t j0, size_t n, value_type* out) const
+  {
+    const value_type* r = row_data(i) + j0;
+    std::copy(r, r + n, out);
+  }
+};
+
+// Транспонирование - O(1) представление: в произведениях и при умножении
+// на вектор матрица читается в хранимом виде (TGemmOperand), в памяти
+// транспонируется только при присваивании или внутри поэлементного выражения
+template<typename E>
+class TMatTransposeExpr : public TMatCachedExpr<TMatTransposeExpr<E>, typename E::matrix_type>
+{
+  typename TExprOperand<E>::type e;
+public:
+  typedef typename E::value_type value_type;
+
+  explicit TMatTransposeExpr(const E& expr) : e(expr) {}
+
+  const E& expr() const noexcept { return e; }
+
+  size_t rows() const noexcept { return e.cols(); }
+  size_t cols() const noexcept { return e.rows(); }
+  value_type operator()(size_t i, size_t j) const { return e(j, i); }
+
+  template<typename M>
+  void eval_to(M& m) const
+  {
+    TMatValue<E> a(e);
+    if (!same_object(a.get(), m))
+      mat_transpose(a.get(), m);
+    else if (m.rows() == m.cols())
+      mat_transpose_inplace(m);
+    else
+    {
+      M tmp(m.rows(), m.cols(), uninitialized, m.get_allocator());
+      mat_transpose(a.get(), tmp);
+      m = std::move(tmp);
+    }
+  }
+};
+
+template<typename E>
+class TGemmOperand<TMatTransposeExpr<E>>
+{
+  TMatValue<E> v;
+public:
+  typedef std::true_type transposed;
+
+  explicit TGemmOperand(const TMatTransposeExpr<E>& e) : v(e.expr()) {}
+  const typename TMatValue<E>::type& get() const noexcept { return v.get(); }
+  size_t rows() const noexcept { return v.get().cols(); }
+  size_t cols() const noexcept { return v.get().rows(); }
+};
+
+// Произведение alpha * L * R
+template<typename L, typename R>
+class TMatProductExpr : public TMatCachedExpr<TMatProductExpr<L, R>, typename L::matrix_type>
+{
+public:
+  typedef typename L::value_type value_type;
+private:
+  typename TExprOperand<L>::type l;
+  typename TExprOperand<R>::type r;
+  value_type alpha;
+public:
+  TMatProductExpr(const L& lhs, const R& rhs, const value_type& a) : l(lhs), r(rhs), alpha(a)
+  {
+    if (l.cols() != r.rows())
+      throw std::length_error("Matrix column count should be equal to row count of the second matrix");
+  }
+
+  const L& left() const noexcept { return l; }
+  const R& right() const noexcept { return r; }
+  const value_type& scale() const noexcept { return alpha; }
+
+  size_t rows() const noexcept { return l.rows(); }
+  size_t cols() const noexcept { return r.cols(); }
+
+  template<typename M>
+  void eval_to(M& m) const
+  {
+    TGemmOperand<L> a(l);
+    TGemmOperand<R> b(r);
+    if (same_object(a.get(), m) || same_object(b.get(), m))
+    {
+      M tmp(m.rows(), m.cols(), uninitialized, m.get_allocator());
+      mat_gemm(alpha, a, b, value_type(), tmp, std::is_arithmetic<value_type>());
+      m = std::move(tmp);
+    }
+    else
+      mat_gemm(alpha, a, b, value_type(), m, std::is_arithmetic<value_type>());
+  }
+};
+
+// alpha * L * R + beta * C - один вызов GEMM с накоплением в C
+template<typename L, typename R, typename C>
+class TMatGemmExpr : public TMatCachedExpr<TMatGemmExpr<L, R, C>, typename L::matrix_type>
+{
+public:
+  typedef typename L::value_type value_type;
+private:
+  typename TExprOperand<L>::type l;
+  typename TExprOperand<R>::type r;
+  typename TExprOperand<C>::type c;
+  value_type alpha, beta;
+public:
+  TMatGemmExpr(const TMatProductExpr<L, R>& p, const C& addend, const value_type& b)
+    : l(p.left()), r(p.right()), c(addend), alpha(p.scale()), beta(b)
+  {
+    if (p.rows() != c.rows() || p.cols() != c.cols())
+      throw std::length_error("Matrices should have equal sizes");
+  }
+
+  size_t rows() const noexcept { return l.rows(); }
+  size_t cols() const noexcept { return r.cols(); }
+
+  template<typename M>
+  void eval_to(M& m) const
+  {
+    TGemmOperand<L> a(l);
+    TGemmOperand<R> b(r);
+    if (same_object(a.get(), m) || same_object(b.get(), m))
+    {
+      M tmp(c, m.get_allocator());
+      mat_gemm(alpha, a, b, beta, tmp, std::is_arithmetic<value_type>());
+      m = std::move(tmp);
+    }
+    else
+    {
+      // m = C, затем m = alpha * A * B + beta * m; если m и есть C, копирования нет
+      c.eval_to(m);
+      mat_gemm(alpha, a, b, beta, m, std::is_arithmetic<value_type>());
+    }
+  }
+};
+
+// Слагаемое или множитель вида s * E: само выражение E и скаляр s
+template<typename E>
+struct TMatScaled
+{
+  typedef E type;
+  static const E& expr(const E& e) noexcept { return e; }
+  static typename E::value_type scale(const E&) { return typename E::value_type(1); }
+};
+template<typename E>
+struct TMatScaled<TMatScalarExpr<TExprMulScalar, E>>
+{
+  typedef E type;
+  static const E& expr(const TMatScalarExpr<TExprMulScalar, E>& e) noexcept { return e.expr(); }
+  static typename E::value_type scale(const TMatScalarExpr<TExprMulScalar, E>& e) { return e.scalar(); }
+};
+
+// матричные операции
+template<typename L, typename R>
+TMatBinaryExpr<TExprAdd, L, R> operator+(const TMatExpr<L>& a, const TMatExpr<R>& b)
+{
+  return TMatBinaryExpr<TExprAdd, L, R>(a.self(), b.self());
+}
+template<typename L, typename R>
+TMatBinaryExpr<TExprSub, L, R> operator-(const TMatExpr<L>& a, const TMatExpr<R>& b)
+{
+  return TMatBinaryExpr<TExprSub, L, R>(a.self(), b.self());
+}
+
+// умножение на скаляр
+template<typename E>
+TMatScalarExpr<TExprMulScalar, E> operator*(const TMatExpr<E>& a, typename E::value_type val)
+{
+  return TMatScalarExpr<TExprMulScalar, E>(a.self(), val);
+}
+template<typename E>
+TMatScalarExpr<TExprMulScalar, E> operator*(typename E::value_type val, const TMatExpr<E>& a)
+{
+  return TMatScalarExpr<TExprMulScalar, E>(a.self(), val);
+}
+
+// транспонирование
+template<typename E>
+TMatTransposeExpr<E> transpose(const TMatExpr<E>& a)
+{
+  return TMatTransposeExpr<E>(a.self());
+}
+
+// умножение матриц; скаляры-множители сомножителей переходят в alpha
+template<typename L, typename R>
+TMatProductExpr<typename TMatScaled<L>::type, typename TMatScaled<R>::type>
+operator*(const TMatExpr<L>& a, const TMatExpr<R>& b)
+{
+  typedef TMatScaled<L> SL;
+  typedef TMatScaled<R> SR;
+  return TMatProductExpr<typename SL::type, typename SR::type>(
+    SL::expr(a.self()), SR::expr(b.self()), SL::scale(a.self()) * SR::scale(b.self()));
+}
+template<typename L, typename R>
+TMatProductExpr<L, R> operator*(const TMatProductExpr<L, R>& p, typename L::value_type val)
+{
+  return TMatProductExpr<L, R>(p.left(), p.right(), p.scale() * val);
+}
+template<typename L, typename R>
+TMatProductExpr<L, R> operator*(typename L::value_type val, const TMatProductExpr<L, R>& p)
+{
+  return TMatProductExpr<L, R>(p.left(), p.right(), val * p.scale());
+}
+
+// alpha * A * B +- beta * C
+template<typename L, typename R, typename E>
+TMatGemmExpr<L, R, typename TMatScaled<E>::type>
+operator+(const TMatProductExpr<L, R>& p, const TMatExpr<E>& c)
+{
+  typedef TMatScaled<E> SC;
+  return TMatGemmExpr<L, R, typename SC::type>(p, SC::expr(c.self()), SC::scale(c.self()));
+}
+template<typename L, typename R, typename E>
+TMatGemmExpr<L, R, typename TMatScaled<E>::type>
+operator+(const TMatExpr<E>& c, const TMatProductExpr<L, R>& p)
+{
+  typedef TMatScaled<E> SC;
+  return TMatGemmExpr<L, R, typename SC::type>(p, SC::expr(c.self()), SC::scale(c.self()));
+}
+template<typename L, typename R, typename E>
+TMatGemmExpr<L, R, typename TMatScaled<E>::type>
+operator-(const TMatProductExpr<L, R>& p, const TMatExpr<E>& c)
+{
+  typedef TMatScaled<E> SC;
+  return TMatGemmExpr<L, R, typename SC::type>(p, SC::expr(c.self()), -SC::scale(c.self()));
+}
+template<typename L, typename R, typename E>
+TMatGemmExpr<L, R, typename TMatScaled<E>::type>
+operator-(const TMatExpr<E>& c, const TMatProductExpr<L, R>& p)
+{
+  typedef TMatScaled<E> SC;
+  return TMatGemmExpr<L, R, typename SC::type>(TMatProductExpr<L, R>(p.left(), p.right(), -p.scale()),
+    SC::expr(c.self()), SC::scale(c.self()));
+}
+// сумма двух произведений: второе вычисляется отдельно
+template<typename L1, typename R1, typename L2, typename R2>
+TMatGemmExpr<L1, R1, TMatProductExpr<L2, R2>>
+operator+(const TMatProductExpr<L1, R1>& p, const TMatProductExpr<L2, R2>& q)
+{
+  return TMatGemmExpr<L1, R1, TMatProductExpr<L2, R2>>(p, q, typename L1::value_type(1));
+}
+template<typename L1, typename R1, typename L2, typename R2>
+TMatGemmExpr<L1, R1, TMatProductExpr<L2, R2>>
+operator-(const TMatProductExpr<L1, R1>& p, const TMatProductExpr<L2, R2>& q)
+{
+  return TMatGemmExpr<L1, R1, TMatProductExpr<L2, R2>>(p, q, -typename L1::value_type(1));
+}
+
+// умножение матрицы на вектор
+template<typename E, typename V>
+TDynamicVector<typename E::value_type, typename E::matrix_type::allocator_type>
+operator*(const TMatExpr<E>& a, const TVecExpr<V>& b)
+{
+  typedef typename E::value_type T;
+  const V& x = b.self();
+  size_t rn = a.self().rows(), n = a.self().cols();
+  if (n != x.size())
+    throw std::length_error("Vector size should be equal to matrix column count");
+  TMatValue<E> m(a.self());
+  std::unique_ptr<TDynamicVector<T>> tmp;
+  const T* px = x.data();
+  if (px == nullptr)
+  {
+    tmp.reset(new TDynamicVector<T>(x));
+    px = tmp->data();
+  }
+  TDynamicVector<T, typename E::matrix_type::allocator_type> res(rn, m.get().get_allocator());
+  for (size_t i = 0; i < rn; i++)
+    res[i] = simd::dot(m.get().row_data(i), px, n);
+  return res;
+}
+// A^T * x = сумма x[i] * (строка i матрицы A): матрица читается по строкам
+template<typename E, typename V>
+TDynamicVector<typename E::value_type, typename E::matrix_type::allocator_type>
+operator*(const TMatTransposeExpr<E>& a, const TVecExpr<V>& b)
+{
+  typedef typename E::value_type T;
+  const V& x = b.self();
+  size_t rn = a.rows(), n = a.cols();
+  if (n != x.size())
+    throw std::length_error("Vector size should be equal to matrix column count");
+  TMatValue<E> m(a.expr());
+  std::unique_ptr<TDynamicVector<T>> tmp;
+  const T* px = x.data();
+  if (px == nullptr)
+  {
+    tmp.reset(new TDynamicVector<T>(x));
+    px = tmp->data();
+  }
+  TDynamicVector<T, typename E::matrix_type::allocator_type> res(rn, m.get().get_allocator());
+  for (size_t i = 0; i < n; i++)
+    simd::axpy(px[i], m.get().row_data(i), res.data(), rn);
+  return res;
+}
+
+#endif
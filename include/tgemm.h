@@ -0,0 +1,478 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Блочное умножение матриц (GEMM)
+
+#ifndef __TGemm_H__
+#define __TGemm_H__
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "tthreadpool.h"
+#include "tsimd.h"
+#include "tmemory.h"
+
+// Параметры разбиения на блоки:
+// MR x NR - регистровый блок микроядра,
+// MC x KC - блок A, который держится в L2,
+// KC x NC - блок B, который держится в L3
+template<typename T>
+struct TGemmTraits
+{
+  static const size_t MR = 4;
+  static const size_t NR = 4;
+  static const size_t MC = 128;
+  static const size_t KC = 256;
+  static const size_t NC = 2048;
+};
+
+// 6 x 8 (double) и 6 x 16 (float): 12 регистров-аккумуляторов AVX2 или 6 регистров AVX-512
+template<>
+struct TGemmTraits<double>
+{
+  static const size_t MR = 6;
+  static const size_t NR = 8;
+  static const size_t MC = 120;
+  static const size_t KC = 256;
+  static const size_t NC = 2048;
+};
+
+template<>
+struct TGemmTraits<float>
+{
+  static const size_t MR = 6;
+  static const size_t NR = 16;
+  static const size_t MC = 120;
+  static const size_t KC = 384;
+  static const size_t NC = 4096;
+};
+
+// Размер, начиная с которого используется блочный алгоритм
+const size_t GEMM_BLOCKED_THRESHOLD = 64;
+// Объем работы m*n*k, начиная с которого умножение распределяется по потокам
+const size_t GEMM_PARALLEL_THRESHOLD = 128 * 128 * 128;
+
+namespace gemm_detail
+{
+  // Упаковка блока A (mc x kc) в полосы по MR строк:
+  // внутри полосы элементы идут по столбцам, недостающие строки дополняются нулями
+  template<typename T, typename RowA>
+  void pack_a(size_t mc, size_t kc, RowA a, size_t i0, size_t p0, T* buf)
+  {
+    const size_t MR = TGemmTraits<T>::MR;
+    for (size_t ir = 0; ir < mc; ir += MR)
+    {
+      size_t mr = std::min(MR, mc - ir);
+      for (size_t i = 0; i < mr; i++)
+      {
+        const T* src = a(i0 + ir + i) + p0;
+        for (size_t p = 0; p < kc; p++)
+          buf[p * MR + i] = src[p];
+      }
+      for (size_t i = mr; i < MR; i++)
+        for (size_t p = 0; p < kc; p++)
+          buf[p * MR + i] = T();
+      buf += MR * kc;
+    }
+  }
+
+  // Упаковка блока B (kc x nc) в полосы по NR столбцов:
+  // внутри полосы элементы идут по строкам
+  template<typename T, typename RowB>
+  void pack_b(size_t kc, size_t nc, RowB b, size_t p0, size_t j0, T* buf)
+  {
+    const size_t NR = TGemmTraits<T>::NR;
+    for (size_t jr = 0; jr < nc; jr += NR)
+    {
+      size_t nr = std::min(NR, nc - jr);
+      for (size_t p = 0; p < kc; p++)
+      {
+        const T* src = b(p0 + p) + j0 + jr;
+        T* dst = buf + p * NR;
+        size_t j = 0;
+        for (; j < nr; j++)
+          dst[j] = src[j];
+        for (; j < NR; j++)
+          dst[j] = T();
+      }
+      buf += NR * kc;
+    }
+  }
+
+  // Сомножитель, хранящийся транспонированным: элемент (i, j) - x(j)[i].
+  // Упаковка читает его строки подряд, поэтому A^T * B и A * B^T
+  // не требуют транспонирования в памяти
+  template<typename Row>
+  struct TTransposed
+  {
+    Row x;
+  };
+
+  // A^T: строка p хранимой матрицы - столбец p блока, читается подряд
+  template<typename T, typename Row>
+  void pack_a(size_t mc, size_t kc, TTransposed<Row> a, size_t i0, size_t p0, T* buf)
+  {
+    const size_t MR = TGemmTraits<T>::MR;
+    for (size_t ir = 0; ir < mc; ir += MR)
+    {
+      size_t mr = std::min(MR, mc - ir);
+      for (size_t p = 0; p < kc; p++)
+      {
+        const T* src = a.x(p0 + p) + i0 + ir;
+        T* dst = buf + p * MR;
+        size_t i = 0;
+        for (; i < mr; i++)
+          dst[i] = src[i];
+        for (; i < MR; i++)
+          dst[i] = T();
+      }
+      buf += MR * kc;
+    }
+  }
+
+  // B^T: строка j хранимой матрицы - столбец j блока
+  template<typename T, typename Row>
+  void pack_b(size_t kc, size_t nc, TTransposed<Row> b, size_t p0, size_t j0, T* buf)
+  {
+    const size_t NR = TGemmTraits<T>::NR;
+    for (size_t jr = 0; jr < nc; jr += NR)
+    {
+      size_t nr = std::min(NR, nc - jr);
+      for (size_t j = 0; j < nr; j++)
+      {
+        const T* src = b.x(j0 + jr + j) + p0;
+        for (size_t p = 0; p < kc; p++)
+          buf[p * NR + j] = src[p];
+      }
+      for (size_t j = nr; j < NR; j++)
+        for (size_t p = 0; p < kc; p++)
+          buf[p * NR + j] = T();
+      buf += NR * kc;
+    }
+  }
+
+  // Сомножитель без первых i0 строк (shift_rows) или j0 столбцов (shift_cols)
+  template<typename Row>
+  struct TShiftRows
+  {
+    Row x;
+    size_t i0;
+    auto operator()(size_t i) const -> decltype(x(i)) { return x(i0 + i); }
+  };
+  template<typename Row>
+  struct TShiftCols
+  {
+    Row x;
+    size_t j0;
+    auto operator()(size_t i) const -> decltype(x(i)) { return x(i) + j0; }
+  };
+  template<typename Row>
+  TShiftRows<Row> shift_rows(Row x, size_t i0) { TShiftRows<Row> r = { x, i0 }; return r; }
+  template<typename Row>
+  TShiftCols<Row> shift_cols(Row x, size_t j0) { TShiftCols<Row> r = { x, j0 }; return r; }
+  // у транспонированного сомножителя строки и столбцы меняются ролями
+  template<typename Row>
+  TTransposed<TShiftCols<Row>> shift_rows(TTransposed<Row> x, size_t i0)
+  {
+    TTransposed<TShiftCols<Row>> r = { shift_cols(x.x, i0) };
+    return r;
+  }
+  template<typename Row>
+  TTransposed<TShiftRows<Row>> shift_cols(TTransposed<Row> x, size_t j0)
+  {
+    TTransposed<TShiftRows<Row>> r = { shift_rows(x.x, j0) };
+    return r;
+  }
+
+  // Микроядро: acc = сумма по p a[:,p] * b[p,:] для регистрового блока MR x NR
+  template<typename T>
+  void micro_kernel(size_t kc, const T* a, const T* b, T* acc)
+  {
+    const size_t MR = TGemmTraits<T>::MR;
+    const size_t NR = TGemmTraits<T>::NR;
+    T c[MR * NR];
+    for (size_t i = 0; i < MR * NR; i++)
+      c[i] = T();
+    for (size_t p = 0; p < kc; p++)
+    {
+      for (size_t i = 0; i < MR; i++)
+      {
+        const T ai = a[i];
+        for (size_t j = 0; j < NR; j++)
+          c[i * NR + j] += ai * b[j];
+      }
+      a += MR;
+      b += NR;
+    }
+    for (size_t i = 0; i < MR * NR; i++)
+      acc[i] = c[i];
+  }
+
+  typedef void (*TMicroKernel64)(size_t, const double*, const double*, double*);
+  typedef void (*TMicroKernel32)(size_t, const float*, const float*, float*);
+}
+
+#ifdef TMATRIX_SIMD_X86
+
+// Микроядра для double 6 x 8 и float 6 x 16 с явными векторными инструкциями.
+// Строка полосы B и строка acc занимают 64 байта, буферы выровнены на
+// MEMORY_ALIGNMENT (см. gemm), поэтому загрузки B и запись acc - выровненные
+#define TMATRIX_GEMM_ROW2(i, LOADA, FMA)                                        \
+  { reg ai = LOADA(a + i); c##i##0 = FMA(ai, b0, c##i##0); c##i##1 = FMA(ai, b1, c##i##1); }
+#define TMATRIX_GEMM_ROW1(i, LOADA, FMA)                                        \
+  { reg ai = LOADA(a + i); c##i##0 = FMA(ai, b0, c##i##0); }
+
+TMATRIX_TARGET_PUSH_AVX2
+namespace gemm_avx2
+{
+  inline void micro_kernel(size_t kc, const double* a, const double* b, double* acc)
+  {
+    typedef __m256d reg;
+    reg c00 = _mm256_setzero_pd(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00,
+        c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    for (size_t p = 0; p < kc; p++)
+    {
+      reg b0 = _mm256_load_pd(b), b1 = _mm256_load_pd(b + 4);
+      TMATRIX_GEMM_ROW2(0, _mm256_broadcast_sd, _mm256_fmadd_pd)
+      TMATRIX_GEMM_ROW2(1, _mm256_broadcast_sd, _mm256_fmadd_pd)
+      TMATRIX_GEMM_ROW2(2, _mm256_broadcast_sd, _mm256_fmadd_pd)
+      TMATRIX_GEMM_ROW2(3, _mm256_broadcast_sd, _mm256_fmadd_pd)
+      TMATRIX_GEMM_ROW2(4, _mm256_broadcast_sd, _mm256_fmadd_pd)
+      TMATRIX_GEMM_ROW2(5, _mm256_broadcast_sd, _mm256_fmadd_pd)
+      a += 6;
+      b += 8;
+    }
+    _mm256_store_pd(acc, c00); _mm256_store_pd(acc + 4, c01);
+    _mm256_store_pd(acc + 8, c10); _mm256_store_pd(acc + 12, c11);
+    _mm256_store_pd(acc + 16, c20); _mm256_store_pd(acc + 20, c21);
+    _mm256_store_pd(acc + 24, c30); _mm256_store_pd(acc + 28, c31);
+    _mm256_store_pd(acc + 32, c40); _mm256_store_pd(acc + 36, c41);
+    _mm256_store_pd(acc + 40, c50); _mm256_store_pd(acc + 44, c51);
+  }
+
+  inline void micro_kernel(size_t kc, const float* a, const float* b, float* acc)
+  {
+    typedef __m256 reg;
+    reg c00 = _mm256_setzero_ps(), c01 = c00, c10 = c00, c11 = c00, c20 = c00, c21 = c00,
+        c30 = c00, c31 = c00, c40 = c00, c41 = c00, c50 = c00, c51 = c00;
+    for (size_t p = 0; p < kc; p++)
+    {
+      reg b0 = _mm256_load_ps(b), b1 = _mm256_load_ps(b + 8);
+      TMATRIX_GEMM_ROW2(0, _mm256_broadcast_ss, _mm256_fmadd_ps)
+      TMATRIX_GEMM_ROW2(1, _mm256_broadcast_ss, _mm256_fmadd_ps)
+      TMATRIX_GEMM_ROW2(2, _mm256_broadcast_ss, _mm256_fmadd_ps)
+      TMATRIX_GEMM_ROW2(3, _mm256_broadcast_ss, _mm256_fmadd_ps)
+      TMATRIX_GEMM_ROW2(4, _mm256_broadcast_ss, _mm256_fmadd_ps)
+      TMATRIX_GEMM_ROW2(5, _mm256_broadcast_ss, _mm256_fmadd_ps)
+      a += 6;
+      b += 16;
+    }
+    _mm256_store_ps(acc, c00); _mm256_store_ps(acc + 8, c01);
+    _mm256_store_ps(acc + 16, c10); _mm256_store_ps(acc + 24, c11);
+    _mm256_store_ps(acc + 32, c20); _mm256_store_ps(acc + 40, c21);
+    _mm256_store_ps(acc + 48, c30); _mm256_store_ps(acc + 56, c31);
+    _mm256_store_ps(acc + 64, c40); _mm256_store_ps(acc + 72, c41);
+    _mm256_store_ps(acc + 80, c50); _mm256_store_ps(acc + 88, c51);
+  }
+}
+TMATRIX_TARGET_POP
+
+TMATRIX_TARGET_PUSH_AVX512
+namespace gemm_avx512
+{
+  inline __m512d broadcast(const double* p) { return _mm512_set1_pd(*p); }
+  inline __m512 broadcast(const float* p) { return _mm512_set1_ps(*p); }
+
+  inline void micro_kernel(size_t kc, const double* a, const double* b, double* acc)
+  {
+    typedef __m512d reg;
+    reg c00 = _mm512_setzero_pd(), c10 = c00, c20 = c00, c30 = c00, c40 = c00, c50 = c00;
+    for (size_t p = 0; p < kc; p++)
+    {
+      reg b0 = _mm512_load_pd(b);
+      TMATRIX_GEMM_ROW1(0, broadcast, _mm512_fmadd_pd)
+      TMATRIX_GEMM_ROW1(1, broadcast, _mm512_fmadd_pd)
+      TMATRIX_GEMM_ROW1(2, broadcast, _mm512_fmadd_pd)
+      TMATRIX_GEMM_ROW1(3, broadcast, _mm512_fmadd_pd)
+      TMATRIX_GEMM_ROW1(4, broadcast, _mm512_fmadd_pd)
+      TMATRIX_GEMM_ROW1(5, broadcast, _mm512_fmadd_pd)
+      a += 6;
+      b += 8;
+    }
+    _mm512_store_pd(acc, c00); _mm512_store_pd(acc + 8, c10);
+    _mm512_store_pd(acc + 16, c20); _mm512_store_pd(acc + 24, c30);
+    _mm512_store_pd(acc + 32, c40); _mm512_store_pd(acc + 40, c50);
+  }
+
+  inline void micro_kernel(size_t kc, const float* a, const float* b, float* acc)
+  {
+    typedef __m512 reg;
+    reg c00 = _mm512_setzero_ps(), c10 = c00, c20 = c00, c30 = c00, c40 = c00, c50 = c00;
+    for (size_t p = 0; p < kc; p++)
+    {
+      reg b0 = _mm512_load_ps(b);
+      TMATRIX_GEMM_ROW1(0, broadcast, _mm512_fmadd_ps)
+      TMATRIX_GEMM_ROW1(1, broadcast, _mm512_fmadd_ps)
+      TMATRIX_GEMM_ROW1(2, broadcast, _mm512_fmadd_ps)
+      TMATRIX_GEMM_ROW1(3, broadcast, _mm512_fmadd_ps)
+      TMATRIX_GEMM_ROW1(4, broadcast, _mm512_fmadd_ps)
+      TMATRIX_GEMM_ROW1(5, broadcast, _mm512_fmadd_ps)
+      a += 6;
+      b += 16;
+    }
+    _mm512_store_ps(acc, c00); _mm512_store_ps(acc + 16, c10);
+    _mm512_store_ps(acc + 32, c20); _mm512_store_ps(acc + 48, c30);
+    _mm512_store_ps(acc + 64, c40); _mm512_store_ps(acc + 80, c50);
+  }
+}
+TMATRIX_TARGET_POP
+
+#undef TMATRIX_GEMM_ROW1
+#undef TMATRIX_GEMM_ROW2
+
+#endif // TMATRIX_SIMD_X86
+
+namespace gemm_detail
+{
+  // Выбор микроядра по текущему набору инструкций
+  template<typename T>
+  void (*select_micro_kernel())(size_t, const T*, const T*, T*)
+  {
+    return &micro_kernel<T>;
+  }
+#ifdef TMATRIX_SIMD_X86
+  template<>
+  inline TMicroKernel64 select_micro_kernel<double>()
+  {
+    switch (simd_level())
+    {
+    case SIMD_AVX512: return &gemm_avx512::micro_kernel;
+    case SIMD_AVX2: return &gemm_avx2::micro_kernel;
+    default: return &micro_kernel<double>;
+    }
+  }
+  template<>
+  inline TMicroKernel32 select_micro_kernel<float>()
+  {
+    switch (simd_level())
+    {
+    case SIMD_AVX512: return &gemm_avx512::micro_kernel;
+    case SIMD_AVX2: return &gemm_avx2::micro_kernel;
+    default: return &micro_kernel<float>;
+    }
+  }
+#endif
+
+  // Запись регистрового блока в C: C = alpha * acc + beta * C
+  template<typename T, typename RowC>
+  void store_tile(size_t mr, size_t nr, const T* acc, T alpha, T beta,
+                  RowC c, size_t i0, size_t j0)
+  {
+    const size_t NR = TGemmTraits<T>::NR;
+    for (size_t i = 0; i < mr; i++)
+    {
+      T* dst = c(i0 + i) + j0;
+      const T* src = acc + i * NR;
+      if (beta == T())
+        for (size_t j = 0; j < nr; j++)
+          dst[j] = alpha * src[j];
+      else
+        for (size_t j = 0; j < nr; j++)
+          dst[j] = alpha * src[j] + beta * dst[j];
+    }
+  }
+}
+
+// Транспонированный сомножитель для gemm: x(i) - строка i хранимой матрицы
+template<typename Row>
+gemm_detail::TTransposed<Row> gemm_transposed(Row x)
+{
+  gemm_detail::TTransposed<Row> r = { x };
+  return r;
+}
+
+// C = alpha * A * B + beta * C
+// A - m x k, B - k x n, C - m x n;
+// a(i), b(i), c(i) возвращают указатель на начало i-й строки;
+// A или B, обернутые в gemm_transposed, хранятся транспонированными
+template<typename T, typename RowA, typename RowB, typename RowC>
+void gemm(size_t m, size_t n, size_t k, T alpha, RowA a, RowB b, T beta, RowC c)
+{
+  typedef TGemmTraits<T> Tr;
+  const size_t MR = Tr::MR, NR = Tr::NR;
+  const size_t MC = Tr::MC, KC = Tr::KC, NC = Tr::NC;
+
+  // буферы и acc выровнены: микроядра читают полосы B и пишут acc
+  // выровненными командами
+  std::vector<T, TAlignedAllocator<T>> bufA(MC * KC);
+  std::vector<T, TAlignedAllocator<T>> bufB(KC * ((std::min(NC, n) + NR - 1) / NR * NR));
+  alignas(MEMORY_ALIGNMENT) T acc[MR * NR];
+  void (*kernel)(size_t, const T*, const T*, T*) = gemm_detail::select_micro_kernel<T>();
+
+  for (size_t jc = 0; jc < n; jc += NC)
+  {
+    size_t nc = std::min(NC, n - jc);
+    for (size_t pc = 0; pc < k; pc += KC)
+    {
+      size_t kc = std::min(KC, k - pc);
+      // первый блок по k учитывает beta, остальные накапливают результат
+      T b_pc = (pc == 0) ? beta : T(1);
+      gemm_detail::pack_b(kc, nc, b, pc, jc, bufB.data());
+      for (size_t ic = 0; ic < m; ic += MC)
+      {
+        size_t mc = std::min(MC, m - ic);
+        gemm_detail::pack_a(mc, kc, a, ic, pc, bufA.data());
+        for (size_t jr = 0; jr < nc; jr += NR)
+        {
+          size_t nr = std::min(NR, nc - jr);
+          for (size_t ir = 0; ir < mc; ir += MR)
+          {
+            size_t mr = std::min(MR, mc - ir);
+            kernel(kc, bufA.data() + ir * kc, bufB.data() + jr * kc, acc);
+            gemm_detail::store_tile(mr, nr, acc, alpha, b_pc, c, ic + ir, jc + jr);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Параллельный вариант gemm:
+// C делится на прямоугольные плитки, каждая плитка считается
+// последовательным gemm в одном из потоков пула
+template<typename T, typename RowA, typename RowB, typename RowC>
+void gemm_parallel(size_t m, size_t n, size_t k, T alpha, RowA a, RowB b, T beta, RowC c,
+                   TThreadPool& pool = thread_pool())
+{
+  const size_t MR = TGemmTraits<T>::MR, NR = TGemmTraits<T>::NR;
+  size_t threads = pool.size();
+  if (threads == 1 || m * n * k < GEMM_PARALLEL_THRESHOLD)
+  {
+    gemm(m, n, k, alpha, a, b, beta, c);
+    return;
+  }
+  // сначала режем по строкам (каждый поток упаковывает свою часть A),
+  // если строк не хватает - дополнительно по столбцам
+  size_t tm = std::min(threads, (m + MR - 1) / MR);
+  size_t tn = std::min((threads + tm - 1) / tm, (n + NR - 1) / NR);
+  size_t rows = ((m + tm - 1) / tm + MR - 1) / MR * MR;
+  size_t cols = ((n + tn - 1) / tn + NR - 1) / NR * NR;
+  tm = (m + rows - 1) / rows;
+  tn = (n + cols - 1) / cols;
+
+  pool.parallel_for(tm * tn, [&](size_t t)
+  {
+    size_t i0 = (t / tn) * rows, j0 = (t % tn) * cols;
+    size_t mt = std::min(rows, m - i0), nt = std::min(cols, n - j0);
+    gemm(mt, nt, k, alpha,
+      gemm_detail::shift_rows(a, i0),
+      gemm_detail::shift_cols(b, j0),
+      beta,
+      [&](size_t i) { return c(i0 + i) + j0; });
+  });
+}
+
+#endif
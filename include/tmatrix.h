@@ -8,100 +8,248 @@
 #define __TDynamicMatrix_H__
 
 #include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "tgemm.h"
+#include "tsimd.h"
+#include "tmemory.h"
+#include "texpr.h"
+#include "tview.h"
 
 using namespace std;
 
 const int MAX_VECTOR_SIZE = 100000000;
 const int MAX_MATRIX_SIZE = 10000;
+// Прямоугольная матрица: каждая размерность - не больше MAX_VECTOR_SIZE
+// (строка и столбец - векторы), элементов - не больше, чем в квадратной
+// матрице MAX_MATRIX_SIZE x MAX_MATRIX_SIZE
+const size_t MAX_MATRIX_ELEMENTS = size_t(MAX_MATRIX_SIZE) * MAX_MATRIX_SIZE;
 
-// Динамический вектор - 
+// Динамический вектор -
 // шаблонный вектор на динамической памяти
-template<typename T>
-class TDynamicVector
+// Alloc - распределитель памяти (tmemory.h), по умолчанию TAlignedAllocator<T>
+// (значение по умолчанию задано в объявлении в texpr.h)
+template<typename T, typename Alloc>
+class TDynamicVector : public TVecExpr<TDynamicVector<T, Alloc>>
 {
 protected:
   size_t sz;
   T* pMem;
-public:
-  TDynamicVector(size_t size = 1) : sz(size)
+  Alloc alloc;
+
+  static size_t check_size(size_t s)
   {
-    if (sz == 0)
+    if (s == 0)
       throw out_of_range("Vector size should be greater than zero");
-    pMem = new T[sz]();// {}; // У типа T д.б. констуктор по умолчанию
+    if (s > MAX_VECTOR_SIZE)
+      throw out_of_range("Vector size should not exceed MAX_VECTOR_SIZE");
+    return s;
+  }
+  void check_slice(size_t i0, size_t n, size_t step) const
+  {
+    if (n == 0 || step == 0 || i0 >= sz || (n - 1) * step >= sz - i0)
+      throw out_of_range("Slice is out of vector");
+  }
+public:
+  typedef T value_type;
+  typedef Alloc allocator_type;
+
+  // элементы - T(); для чисел - нули, большие блоки обнуляются ОС при первом обращении
+  TDynamicVector(size_t size = 1, const Alloc& a = Alloc()) : sz(check_size(size)), pMem(nullptr), alloc(a)
+  {
+    pMem = alloc_create(alloc, sz); // У типа T д.б. констуктор по умолчанию
+  }
+  // элементы не инициализируются
+  TDynamicVector(size_t size, TUninitialized, const Alloc& a = Alloc()) : sz(check_size(size)), pMem(nullptr), alloc(a)
+  {
+    pMem = alloc_create_default(alloc, sz);
   }
-  TDynamicVector(T* arr, size_t s) : sz(s)
+  TDynamicVector(T* arr, size_t s, const Alloc& a = Alloc()) : sz(check_size(s)), pMem(nullptr), alloc(a)
   {
     assert(arr != nullptr && "TDynamicVector ctor requires non-nullptr arg");
-    pMem = new T[sz];
-    std::copy(arr, arr + sz, pMem);
+    pMem = alloc_copy(alloc, arr, sz);
   }
   TDynamicVector(const TDynamicVector& v)
+    : sz(v.sz), pMem(nullptr),
+      alloc(std::allocator_traits<Alloc>::select_on_container_copy_construction(v.alloc))
+  {
+    pMem = alloc_copy(alloc, v.pMem, sz);
+  }
+  TDynamicVector(TDynamicVector&& v) noexcept : sz(0), pMem(nullptr), alloc(v.alloc)
   {
+    swap(*this, v);
   }
-  TDynamicVector(TDynamicVector&& v) noexcept
+  // вычисление выражения за один проход с одним выделением памяти
+  template<typename E>
+  TDynamicVector(const TVecExpr<E>& e, const Alloc& a = Alloc()) : sz(e.self().size()), pMem(nullptr), alloc(a)
   {
+    pMem = alloc_create_default(alloc, sz);
+    try
+    {
+      expr_assign(e, pMem);
+    }
+    catch (...)
+    {
+      alloc_destroy(alloc, pMem, sz);
+      throw;
+    }
   }
   ~TDynamicVector()
   {
+    alloc_destroy(alloc, pMem, sz);
   }
   TDynamicVector& operator=(const TDynamicVector& v)
   {
+    if (this == &v)
+      return *this;
+    if (sz != v.sz)
+    {
+      T* p = alloc_create_default(alloc, v.sz);
+      alloc_destroy(alloc, pMem, sz);
+      pMem = p;
+      sz = v.sz;
+    }
+    copy_elements(v.pMem, sz, pMem);
+    return *this;
   }
   TDynamicVector& operator=(TDynamicVector&& v) noexcept
   {
+    swap(*this, v);
+    return *this;
+  }
+  // при совпадении размеров память не выделяется;
+  // выражение может содержать сам вектор (операции поэлементные)
+  template<typename E>
+  TDynamicVector& operator=(const TVecExpr<E>& e)
+  {
+    if (sz != e.self().size())
+    {
+      TDynamicVector tmp(e, alloc);
+      swap(*this, tmp);
+      return *this;
+    }
+    expr_assign(e, pMem);
+    return *this;
   }
 
   size_t size() const noexcept { return sz; }
+  Alloc get_allocator() const { return alloc; }
+
+  // доступ к памяти для выражений и ядер
+  T* data() noexcept { return pMem; }
+  const T* data() const noexcept { return pMem; }
+  void eval(size_t i0, size_t n, T* out) const
+  {
+    std::copy(pMem + i0, pMem + i0 + n, out);
+  }
 
   // индексация
   T& operator[](size_t ind)
   {
+    return pMem[ind];
   }
   const T& operator[](size_t ind) const
   {
+    return pMem[ind];
   }
   // индексация с контролем
   T& at(size_t ind)
   {
+    if (ind >= sz)
+      throw out_of_range("Vector index is out of range");
+    return pMem[ind];
   }
   const T& at(size_t ind) const
   {
+    if (ind >= sz)
+      throw out_of_range("Vector index is out of range");
+    return pMem[ind];
+  }
+
+  // элементы i0, i0 + step, ..., i0 + (n - 1) * step без копирования
+  TVectorView<T> slice(size_t i0, size_t n, size_t step = 1)
+  {
+    check_slice(i0, n, step);
+    return TVectorView<T>(pMem + i0, n, step);
+  }
+  TVectorView<const T> slice(size_t i0, size_t n, size_t step = 1) const
+  {
+    check_slice(i0, n, step);
+    return TVectorView<const T>(pMem + i0, n, step);
   }
 
   // сравнение
   bool operator==(const TDynamicVector& v) const noexcept
   {
+    if (sz != v.sz)
+      return false;
+    return equal_elements(pMem, v.pMem, sz);
   }
   bool operator!=(const TDynamicVector& v) const noexcept
   {
+    return !(*this == v);
   }
 
-  // скалярные операции
-  TDynamicVector operator+(T val)
+  // арифметические операции (+, -, * со скаляром и вектором) - в texpr.h,
+  // они строят выражения, которые вычисляются при присваивании
+
+  // обновление на месте, без выделения памяти
+  template<typename E>
+  TDynamicVector& operator+=(const TVecExpr<E>& e)
   {
+    if (sz != e.self().size())
+      throw length_error("Vectors should have equal sizes");
+    expr_update<TExprAdd>(e, pMem);
+    return *this;
   }
-  TDynamicVector operator-(double val)
+  template<typename E>
+  TDynamicVector& operator-=(const TVecExpr<E>& e)
   {
+    if (sz != e.self().size())
+      throw length_error("Vectors should have equal sizes");
+    expr_update<TExprSub>(e, pMem);
+    return *this;
   }
-  TDynamicVector operator*(double val)
+  // v += alpha * x, v -= alpha * x - одно умножение-сложение на элемент
+  template<typename E>
+  TDynamicVector& operator+=(const TVecScalarExpr<TExprMulScalar, E>& e)
   {
+    if (sz != e.size())
+      throw length_error("Vectors should have equal sizes");
+    expr_axpy(e.scalar(), e.expr(), pMem);
+    return *this;
   }
-
-  // векторные операции
-  TDynamicVector operator+(const TDynamicVector& v)
+  template<typename E>
+  TDynamicVector& operator-=(const TVecScalarExpr<TExprMulScalar, E>& e)
   {
+    if (sz != e.size())
+      throw length_error("Vectors should have equal sizes");
+    expr_axpy(-e.scalar(), e.expr(), pMem);
+    return *this;
   }
-  TDynamicVector operator-(const TDynamicVector& v)
+  TDynamicVector& operator+=(const T& val)
   {
+    simd::add_scalar(pMem, val, pMem, sz);
+    return *this;
   }
-  T operator*(const TDynamicVector& v) noexcept(noexcept(T()))
+  TDynamicVector& operator-=(const T& val)
   {
+    simd::sub_scalar(pMem, val, pMem, sz);
+    return *this;
+  }
+  TDynamicVector& operator*=(const T& val)
+  {
+    simd::mul_scalar(pMem, val, pMem, sz);
+    return *this;
   }
 
   friend void swap(TDynamicVector& lhs, TDynamicVector& rhs) noexcept
   {
     std::swap(lhs.sz, rhs.sz);
     std::swap(lhs.pMem, rhs.pMem);
+    std::swap(lhs.alloc, rhs.alloc);
   }
 
   // ввод/вывод
@@ -119,56 +267,661 @@ public:
   }
 };
 
+// y = alpha * x + y
+template<typename T, typename A>
+void axpy(typename TDynamicVector<T, A>::value_type alpha, const TDynamicVector<T, A>& x, TDynamicVector<T, A>& y)
+{
+  y += alpha * x;
+}
 
-// Динамическая матрица - 
-// шаблонная матрица на динамической памяти
-template<typename T>
-class TDynamicMatrix : private TDynamicVector<TDynamicVector<T>>
+// Операции с временным вектором: результат пишется в его память,
+// и вектор возвращается перемещением, поэтому f() + a + b не выделяет память
+template<typename T, typename A, typename E>
+TDynamicVector<T, A> operator+(TDynamicVector<T, A>&& a, const TVecExpr<E>& b)
+{
+  a += b.self();
+  return std::move(a);
+}
+template<typename T, typename A, typename E>
+TDynamicVector<T, A> operator+(const TVecExpr<E>& a, TDynamicVector<T, A>&& b)
+{
+  b += a.self();
+  return std::move(b);
+}
+template<typename T, typename A>
+TDynamicVector<T, A> operator+(TDynamicVector<T, A>&& a, TDynamicVector<T, A>&& b)
+{
+  a += b;
+  return std::move(a);
+}
+template<typename T, typename A, typename E>
+TDynamicVector<T, A> operator-(TDynamicVector<T, A>&& a, const TVecExpr<E>& b)
+{
+  a -= b.self();
+  return std::move(a);
+}
+template<typename T, typename A, typename E>
+TDynamicVector<T, A> operator-(const TVecExpr<E>& a, TDynamicVector<T, A>&& b)
+{
+  b = a.self() - b;
+  return std::move(b);
+}
+template<typename T, typename A>
+TDynamicVector<T, A> operator-(TDynamicVector<T, A>&& a, TDynamicVector<T, A>&& b)
+{
+  a -= b;
+  return std::move(a);
+}
+template<typename T, typename A>
+TDynamicVector<T, A> operator+(TDynamicVector<T, A>&& a, typename TDynamicVector<T, A>::value_type val)
+{
+  a += val;
+  return std::move(a);
+}
+template<typename T, typename A>
+TDynamicVector<T, A> operator-(TDynamicVector<T, A>&& a, typename TDynamicVector<T, A>::value_type val)
+{
+  a -= val;
+  return std::move(a);
+}
+template<typename T, typename A>
+TDynamicVector<T, A> operator*(TDynamicVector<T, A>&& a, typename TDynamicVector<T, A>::value_type val)
+{
+  a *= val;
+  return std::move(a);
+}
+template<typename T, typename A>
+TDynamicVector<T, A> operator*(typename TDynamicVector<T, A>::value_type val, TDynamicVector<T, A>&& a)
 {
-  using TDynamicVector<TDynamicVector<T>>::pMem;
-  using TDynamicVector<TDynamicVector<T>>::sz;
+  a *= val;
+  return std::move(a);
+}
+
+
+// Хранение элементов матрицы -
+// вектор векторов, каждая строка в отдельном блоке памяти
+// (значение Alloc по умолчанию задано в объявлении в texpr.h)
+template<typename T, typename Alloc>
+class TRowStorage
+{
+  typedef TDynamicVector<T, Alloc> row_type;
+  typedef typename std::allocator_traits<Alloc>::template rebind_alloc<row_type> row_alloc;
+
+  TDynamicVector<row_type, row_alloc> vec;
 public:
-  TDynamicMatrix(size_t s = 1) : TDynamicVector<TDynamicVector<T>>(s)
+  typedef Alloc allocator_type;
+  static const bool is_contiguous = false;
+
+  TRowStorage(size_t r = 1, size_t c = 1, const Alloc& a = Alloc()) : vec(r, row_alloc(a))
   {
-    for (size_t i = 0; i < sz; i++)
-      pMem[i] = TDynamicVector<T>(sz);
+    for (size_t i = 0; i < r; i++)
+      vec[i] = row_type(c, a);
+  }
+  TRowStorage(size_t r, size_t c, TUninitialized, const Alloc& a = Alloc()) : vec(r, row_alloc(a))
+  {
+    for (size_t i = 0; i < r; i++)
+      vec[i] = row_type(c, uninitialized, a);
   }
 
-  using TDynamicVector<TDynamicVector<T>>::operator[];
+  size_t rows() const noexcept { return vec.size(); }
+  size_t cols() const noexcept { return vec[0].size(); }
+  Alloc get_allocator() const { return Alloc(vec.get_allocator()); }
 
-  // сравнение
-  bool operator==(const TDynamicMatrix& m) const noexcept
+  row_type& operator[](size_t ind) { return vec[ind]; }
+  const row_type& operator[](size_t ind) const { return vec[ind]; }
+
+  // указатель на начало строки
+  T* row(size_t ind) { return vec[ind].data(); }
+  const T* row(size_t ind) const { return vec[ind].data(); }
+
+  // участки памяти, расположенные подряд (для поэлементных операций)
+  size_t segments() const noexcept { return rows(); }
+  size_t segment_size() const noexcept { return cols(); }
+  T* segment(size_t k) { return row(k); }
+  const T* segment(size_t k) const { return row(k); }
+
+  friend void swap(TRowStorage& lhs, TRowStorage& rhs) noexcept
+  {
+    swap(lhs.vec, rhs.vec);
+  }
+};
+
+// Хранение элементов матрицы -
+// единый блок памяти, строки расположены подряд (row-major);
+// длина строки в памяти (stride) дополнена до кратной MEMORY_ALIGNMENT байт,
+// поэтому каждая строка выровнена так же, как начало блока
+template<typename T, typename Alloc = TAlignedAllocator<T>>
+class TContiguousStorage
+{
+  size_t nr, nc;
+  size_t st;
+  T* pMem;
+  Alloc alloc;
+public:
+  typedef Alloc allocator_type;
+  static const bool is_contiguous = true;
+
+  TContiguousStorage(size_t r = 1, size_t c = 1, const Alloc& a = Alloc())
+    : nr(r), nc(c), st(aligned_stride<T>(c)), pMem(nullptr), alloc(a)
+  {
+    if (nr == 0 || nc == 0)
+      throw out_of_range("Matrix size should be greater than zero");
+    pMem = alloc_create(alloc, nr * st);
+  }
+  TContiguousStorage(size_t r, size_t c, TUninitialized, const Alloc& a = Alloc())
+    : nr(r), nc(c), st(aligned_stride<T>(c)), pMem(nullptr), alloc(a)
+  {
+    if (nr == 0 || nc == 0)
+      throw out_of_range("Matrix size should be greater than zero");
+    pMem = alloc_create_default(alloc, nr * st);
+  }
+  TContiguousStorage(const TContiguousStorage& m)
+    : nr(m.nr), nc(m.nc), st(m.st), pMem(nullptr),
+      alloc(std::allocator_traits<Alloc>::select_on_container_copy_construction(m.alloc))
+  {
+    pMem = alloc_copy(alloc, m.pMem, nr * st);
+  }
+  TContiguousStorage(TContiguousStorage&& m) noexcept : nr(0), nc(0), st(0), pMem(nullptr), alloc(m.alloc)
+  {
+    swap(*this, m);
+  }
+  ~TContiguousStorage()
+  {
+    alloc_destroy(alloc, pMem, nr * st);
+  }
+  TContiguousStorage& operator=(const TContiguousStorage& m)
+  {
+    if (this == &m)
+      return *this;
+    if (nr * st != m.nr * m.st)
+    {
+      T* p = alloc_create_default(alloc, m.nr * m.st);
+      alloc_destroy(alloc, pMem, nr * st);
+      pMem = p;
+    }
+    nr = m.nr;
+    nc = m.nc;
+    st = m.st;
+    copy_elements(m.pMem, nr * st, pMem);
+    return *this;
+  }
+  TContiguousStorage& operator=(TContiguousStorage&& m) noexcept
+  {
+    swap(*this, m);
+    return *this;
+  }
+
+  size_t rows() const noexcept { return nr; }
+  size_t cols() const noexcept { return nc; }
+  size_t stride() const noexcept { return st; }
+  Alloc get_allocator() const { return alloc; }
+
+  // m[i] - указатель на строку, поэтому m[i][j] работает как обычно
+  T* operator[](size_t ind) { return pMem + ind * st; }
+  const T* operator[](size_t ind) const { return pMem + ind * st; }
+
+  T* row(size_t ind) { return pMem + ind * st; }
+  const T* row(size_t ind) const { return pMem + ind * st; }
+
+  T* data() noexcept { return pMem; }
+  const T* data() const noexcept { return pMem; }
+
+  // без дополнения вся матрица - один участок, иначе участок - строка
+  size_t segments() const noexcept { return st == nc ? 1 : nr; }
+  size_t segment_size() const noexcept { return st == nc ? nr * nc : nc; }
+  T* segment(size_t k) { return pMem + k * st; }
+  const T* segment(size_t k) const { return pMem + k * st; }
+
+  friend void swap(TContiguousStorage& lhs, TContiguousStorage& rhs) noexcept
+  {
+    std::swap(lhs.nr, rhs.nr);
+    std::swap(lhs.nc, rhs.nc);
+    std::swap(lhs.st, rhs.st);
+    std::swap(lhs.pMem, rhs.pMem);
+    std::swap(lhs.alloc, rhs.alloc);
+  }
+};
+
+// Хранение элементов матрицы с копированием при записи (copy-on-write) -
+// размещение как у TContiguousStorage, но копии разделяют один блок памяти
+// со счетчиком ссылок. Собственная копия блока делается при первом
+// неконстантном доступе (m[i], at, row, segment, data); константный доступ
+// и копирование матрицы - O(1)
+template<typename T, typename Alloc = TAlignedAllocator<T>>
+class TSharedStorage
+{
+  struct TDeleter
+  {
+    Alloc alloc;
+    size_t n;
+    void operator()(T* p) { alloc_destroy(alloc, p, n); }
+  };
+
+  size_t nr, nc;
+  size_t st;
+  std::shared_ptr<T> pMem;
+  Alloc alloc;
+
+  void reset(T* p)
+  {
+    TDeleter d = { alloc, nr * st };
+    try
+    {
+      pMem = std::shared_ptr<T>(p, d, alloc);
+    }
+    catch (...)
+    {
+      alloc_destroy(alloc, p, nr * st);
+      throw;
+    }
+  }
+  // отделение от других владельцев блока
+  T* own()
+  {
+    if (pMem.use_count() > 1)
+      reset(alloc_copy(alloc, pMem.get(), nr * st));
+    return pMem.get();
+  }
+public:
+  typedef Alloc allocator_type;
+  static const bool is_contiguous = true;
+
+  TSharedStorage(size_t r = 1, size_t c = 1, const Alloc& a = Alloc())
+    : nr(r), nc(c), st(aligned_stride<T>(c)), alloc(a)
+  {
+    if (nr == 0 || nc == 0)
+      throw out_of_range("Matrix size should be greater than zero");
+    reset(alloc_create(alloc, nr * st));
+  }
+  TSharedStorage(size_t r, size_t c, TUninitialized, const Alloc& a = Alloc())
+    : nr(r), nc(c), st(aligned_stride<T>(c)), alloc(a)
   {
+    if (nr == 0 || nc == 0)
+      throw out_of_range("Matrix size should be greater than zero");
+    reset(alloc_create_default(alloc, nr * st));
   }
+  // копирование и присваивание не копируют элементы
+  TSharedStorage(const TSharedStorage& m) = default;
+  TSharedStorage(TSharedStorage&& m) noexcept : nr(0), nc(0), st(0), alloc(m.alloc)
+  {
+    swap(*this, m);
+  }
+  TSharedStorage& operator=(const TSharedStorage& m) = default;
+  TSharedStorage& operator=(TSharedStorage&& m) noexcept
+  {
+    swap(*this, m);
+    return *this;
+  }
+
+  size_t rows() const noexcept { return nr; }
+  size_t cols() const noexcept { return nc; }
+  size_t stride() const noexcept { return st; }
+  Alloc get_allocator() const { return alloc; }
+  // блок разделяется с другими матрицами
+  bool shared() const noexcept { return pMem.use_count() > 1; }
+
+  T* operator[](size_t ind) { return own() + ind * st; }
+  const T* operator[](size_t ind) const { return pMem.get() + ind * st; }
 
-  // матрично-скалярные операции
-  TDynamicVector<T> operator*(const T& val)
+  T* row(size_t ind) { return own() + ind * st; }
+  const T* row(size_t ind) const { return pMem.get() + ind * st; }
+
+  T* data() { return own(); }
+  const T* data() const noexcept { return pMem.get(); }
+
+  size_t segments() const noexcept { return st == nc ? 1 : nr; }
+  size_t segment_size() const noexcept { return st == nc ? nr * nc : nc; }
+  T* segment(size_t k) { return own() + k * st; }
+  const T* segment(size_t k) const { return pMem.get() + k * st; }
+
+  friend void swap(TSharedStorage& lhs, TSharedStorage& rhs) noexcept
   {
+    std::swap(lhs.nr, rhs.nr);
+    std::swap(lhs.nc, rhs.nc);
+    std::swap(lhs.st, rhs.st);
+    lhs.pMem.swap(rhs.pMem);
+    std::swap(lhs.alloc, rhs.alloc);
   }
+};
+
+
+// Динамическая матрица -
+// шаблонная матрица rows x cols на динамической памяти
+// Storage - способ хранения элементов (TRowStorage, TContiguousStorage
+// или TSharedStorage),
+// распределитель памяти задается параметром Storage
+// (по умолчанию TRowStorage<T>, задано в объявлении в texpr.h)
+template<typename T, typename Storage>
+class TDynamicMatrix : public TMatExpr<TDynamicMatrix<T, Storage>>, private Storage
+{
+  using Storage::row;
+  using Storage::segments;
+  using Storage::segment_size;
+  using Storage::segment;
 
-  // матрично-векторные операции
-  TDynamicVector<T> operator*(const TDynamicVector<T>& v)
+  // возвращает r, чтобы проверка выполнялась до создания Storage
+  static size_t check_size(size_t r, size_t c)
+  {
+    if (r == 0 || c == 0)
+      throw out_of_range("Matrix size should be greater than zero");
+    if (r > MAX_VECTOR_SIZE || c > MAX_VECTOR_SIZE)
+      throw out_of_range("Matrix dimension should not exceed MAX_VECTOR_SIZE");
+    if (c > MAX_MATRIX_ELEMENTS / r)
+      throw out_of_range("Matrix should not have more than MAX_MATRIX_ELEMENTS elements");
+    return r;
+  }
+  void check_equal_size(size_t r, size_t c) const
   {
+    if (rows() != r || cols() != c)
+      throw length_error("Matrices should have equal sizes");
   }
+  void check_block(size_t i0, size_t j0, size_t m, size_t n) const
+  {
+    if (m == 0 || n == 0 || i0 >= rows() || j0 >= cols() || m > rows() - i0 || n > cols() - j0)
+      throw out_of_range("Block is out of matrix");
+  }
+public:
+  typedef T value_type;
+  typedef TDynamicMatrix matrix_type;
+  typedef Storage storage_type;
+  typedef typename Storage::allocator_type allocator_type;
 
-  // матрично-матричные операции
-  TDynamicMatrix operator+(const TDynamicMatrix& m)
+  // квадратная матрица s x s
+  TDynamicMatrix(size_t s = 1, const allocator_type& a = allocator_type()) : Storage(check_size(s, s), s, a)
+  {
+  }
+  TDynamicMatrix(size_t r, size_t c, const allocator_type& a = allocator_type()) : Storage(check_size(r, c), c, a)
+  {
+  }
+  // элементы не инициализируются
+  TDynamicMatrix(size_t s, TUninitialized, const allocator_type& a = allocator_type())
+    : Storage(check_size(s, s), s, uninitialized, a)
+  {
+  }
+  TDynamicMatrix(size_t r, size_t c, TUninitialized, const allocator_type& a = allocator_type())
+    : Storage(check_size(r, c), c, uninitialized, a)
   {
   }
-  TDynamicMatrix operator-(const TDynamicMatrix& m)
+  template<typename E>
+  TDynamicMatrix(const TMatExpr<E>& e, const allocator_type& a = allocator_type())
+    : Storage(check_size(e.self().rows(), e.self().cols()), e.self().cols(), uninitialized, a)
   {
+    e.self().eval_to(*this);
   }
-  TDynamicMatrix operator*(const TDynamicMatrix& m)
+  template<typename E>
+  TDynamicMatrix& operator=(const TMatExpr<E>& e)
   {
+    if (rows() != e.self().rows() || cols() != e.self().cols())
+    {
+      TDynamicMatrix tmp(e, get_allocator());
+      swap(*this, tmp);
+    }
+    else
+      e.self().eval_to(*this);
+    return *this;
+  }
+
+  using Storage::operator[];
+  using Storage::rows;
+  using Storage::cols;
+  using Storage::get_allocator;
+
+  // число строк (для квадратной матрицы - ее размер)
+  size_t size() const noexcept { return rows(); }
+
+  // индексация с контролем
+  T& at(size_t i, size_t j)
+  {
+    if (i >= rows() || j >= cols())
+      throw out_of_range("Matrix index is out of range");
+    return row(i)[j];
+  }
+  const T& at(size_t i, size_t j) const
+  {
+    if (i >= rows() || j >= cols())
+      throw out_of_range("Matrix index is out of range");
+    return row(i)[j];
+  }
+
+  // представления без копирования элементов; для TSharedStorage неконстантное
+  // представление, как и указатель m[i], нельзя использовать после копирования матрицы
+  TVectorView<T> row_view(size_t i)
+  {
+    if (i >= rows())
+      throw out_of_range("Matrix index is out of range");
+    return TVectorView<T>(row(i), cols());
+  }
+  TVectorView<const T> row_view(size_t i) const
+  {
+    if (i >= rows())
+      throw out_of_range("Matrix index is out of range");
+    return TVectorView<const T>(row(i), cols());
+  }
+  // столбцы и блоки - только при непрерывном хранении (постоянный шаг строк)
+  TVectorView<T> col_view(size_t j)
+  {
+    static_assert(Storage::is_contiguous, "Column view requires contiguous storage");
+    if (j >= cols())
+      throw out_of_range("Matrix index is out of range");
+    return TVectorView<T>(Storage::data() + j, rows(), Storage::stride());
+  }
+  TVectorView<const T> col_view(size_t j) const
+  {
+    static_assert(Storage::is_contiguous, "Column view requires contiguous storage");
+    if (j >= cols())
+      throw out_of_range("Matrix index is out of range");
+    return TVectorView<const T>(Storage::data() + j, rows(), Storage::stride());
+  }
+  // блок m x n с левым верхним элементом (i0, j0)
+  TMatrixView<T> submatrix(size_t i0, size_t j0, size_t m, size_t n)
+  {
+    static_assert(Storage::is_contiguous, "Submatrix view requires contiguous storage");
+    check_block(i0, j0, m, n);
+    return TMatrixView<T>(Storage::data() + i0 * Storage::stride() + j0, m, n, Storage::stride());
+  }
+  TMatrixView<const T> submatrix(size_t i0, size_t j0, size_t m, size_t n) const
+  {
+    static_assert(Storage::is_contiguous, "Submatrix view requires contiguous storage");
+    check_block(i0, j0, m, n);
+    return TMatrixView<const T>(Storage::data() + i0 * Storage::stride() + j0, m, n, Storage::stride());
+  }
+  // квадратный блок n x n
+  TMatrixView<T> submatrix(size_t i0, size_t j0, size_t n) { return submatrix(i0, j0, n, n); }
+  TMatrixView<const T> submatrix(size_t i0, size_t j0, size_t n) const { return submatrix(i0, j0, n, n); }
+
+  // интерфейс матричного выражения
+  const T& operator()(size_t i, size_t j) const { return row(i)[j]; }
+  T* row_data(size_t i) { return row(i); }
+  const T* row_data(size_t i) const { return row(i); }
+  void eval_row(size_t i, size_t j0, size_t n, T* out) const
+  {
+    std::copy(row(i) + j0, row(i) + j0 + n, out);
+  }
+  template<typename M>
+  void eval_to(M& m) const
+  {
+    if (static_cast<const void*>(this) == static_cast<const void*>(&m))
+      return;
+    for (size_t i = 0; i < rows(); i++)
+      copy_elements(row(i), cols(), m.row_data(i));
+  }
+
+  // сравнение
+  bool operator==(const TDynamicMatrix& m) const noexcept
+  {
+    if (rows() != m.rows() || cols() != m.cols())
+      return false;
+    for (size_t k = 0; k < segments(); k++)
+      if (!equal_elements(segment(k), m.segment(k), segment_size()))
+        return false;
+    return true;
+  }
+  bool operator!=(const TDynamicMatrix& m) const noexcept
+  {
+    return !(*this == m);
+  }
+
+  // арифметические операции (+, -, * со скаляром, вектором и матрицей) - в texpr.h,
+  // они строят выражения, которые вычисляются при присваивании
+
+  // обновление на месте, без выделения памяти
+  template<typename E>
+  TDynamicMatrix& operator+=(const TMatExpr<E>& e)
+  {
+    check_equal_size(e.self().rows(), e.self().cols());
+    mat_update<TExprAdd>(e.self(), *this);
+    return *this;
+  }
+  template<typename E>
+  TDynamicMatrix& operator-=(const TMatExpr<E>& e)
+  {
+    check_equal_size(e.self().rows(), e.self().cols());
+    mat_update<TExprSub>(e.self(), *this);
+    return *this;
+  }
+  // m += alpha * x, m -= alpha * x - одно умножение-сложение на элемент
+  template<typename E>
+  TDynamicMatrix& operator+=(const TMatScalarExpr<TExprMulScalar, E>& e)
+  {
+    check_equal_size(e.rows(), e.cols());
+    mat_axpy(e.scalar(), e.expr(), *this);
+    return *this;
+  }
+  template<typename E>
+  TDynamicMatrix& operator-=(const TMatScalarExpr<TExprMulScalar, E>& e)
+  {
+    check_equal_size(e.rows(), e.cols());
+    mat_axpy(-e.scalar(), e.expr(), *this);
+    return *this;
+  }
+  // m += alpha * A * B - GEMM с накоплением прямо в m
+  template<typename L, typename R>
+  TDynamicMatrix& operator+=(const TMatProductExpr<L, R>& p)
+  {
+    return *this = TMatGemmExpr<L, R, TDynamicMatrix>(p, *this, T(1));
+  }
+  template<typename L, typename R>
+  TDynamicMatrix& operator-=(const TMatProductExpr<L, R>& p)
+  {
+    return *this = TMatGemmExpr<L, R, TDynamicMatrix>(
+      TMatProductExpr<L, R>(p.left(), p.right(), -p.scale()), *this, T(1));
+  }
+  TDynamicMatrix& operator*=(const T& val)
+  {
+    for (size_t k = 0; k < segments(); k++)
+      simd::mul_scalar(segment(k), val, segment(k), segment_size());
+    return *this;
+  }
+
+  friend void swap(TDynamicMatrix& lhs, TDynamicMatrix& rhs) noexcept
+  {
+    swap(static_cast<Storage&>(lhs), static_cast<Storage&>(rhs));
   }
 
   // ввод/вывод
   friend istream& operator>>(istream& istr, TDynamicMatrix& v)
   {
+    for (size_t i = 0; i < v.rows(); i++)
+    {
+      T* r = v.row(i);
+      for (size_t j = 0; j < v.cols(); j++)
+        istr >> r[j];
+    }
+    return istr;
   }
   friend ostream& operator<<(ostream& ostr, const TDynamicMatrix& v)
   {
+    for (size_t i = 0; i < v.rows(); i++)
+    {
+      const T* r = v.row(i);
+      for (size_t j = 0; j < v.cols(); j++)
+        ostr << r[j] << ' ';
+      ostr << endl;
+    }
+    return ostr;
   }
 };
 
+// y = alpha * x + y
+template<typename T, typename S1, typename S2>
+void axpy(typename TDynamicMatrix<T, S1>::value_type alpha, const TDynamicMatrix<T, S1>& x, TDynamicMatrix<T, S2>& y)
+{
+  y += alpha * x;
+}
+
+// Операции с временной матрицей - аналогично вектору, результат пишется
+// в ее память; A * B прибавляется к ней одним вызовом GEMM с накоплением
+template<typename T, typename S, typename E>
+TDynamicMatrix<T, S> operator+(TDynamicMatrix<T, S>&& a, const TMatExpr<E>& b)
+{
+  a += b.self();
+  return std::move(a);
+}
+template<typename T, typename S, typename E>
+TDynamicMatrix<T, S> operator+(const TMatExpr<E>& a, TDynamicMatrix<T, S>&& b)
+{
+  b += a.self();
+  return std::move(b);
+}
+template<typename T, typename S>
+TDynamicMatrix<T, S> operator+(TDynamicMatrix<T, S>&& a, TDynamicMatrix<T, S>&& b)
+{
+  a += b;
+  return std::move(a);
+}
+template<typename T, typename S, typename L, typename R>
+TDynamicMatrix<T, S> operator+(TDynamicMatrix<T, S>&& a, const TMatProductExpr<L, R>& p)
+{
+  a += p;
+  return std::move(a);
+}
+template<typename T, typename S, typename L, typename R>
+TDynamicMatrix<T, S> operator+(const TMatProductExpr<L, R>& p, TDynamicMatrix<T, S>&& b)
+{
+  b += p;
+  return std::move(b);
+}
+template<typename T, typename S, typename E>
+TDynamicMatrix<T, S> operator-(TDynamicMatrix<T, S>&& a, const TMatExpr<E>& b)
+{
+  a -= b.self();
+  return std::move(a);
+}
+template<typename T, typename S, typename E>
+TDynamicMatrix<T, S> operator-(const TMatExpr<E>& a, TDynamicMatrix<T, S>&& b)
+{
+  b = a.self() - b;
+  return std::move(b);
+}
+template<typename T, typename S>
+TDynamicMatrix<T, S> operator-(TDynamicMatrix<T, S>&& a, TDynamicMatrix<T, S>&& b)
+{
+  a -= b;
+  return std::move(a);
+}
+template<typename T, typename S, typename L, typename R>
+TDynamicMatrix<T, S> operator-(TDynamicMatrix<T, S>&& a, const TMatProductExpr<L, R>& p)
+{
+  a -= p;
+  return std::move(a);
+}
+template<typename T, typename S, typename L, typename R>
+TDynamicMatrix<T, S> operator-(const TMatProductExpr<L, R>& p, TDynamicMatrix<T, S>&& b)
+{
+  b = p - b;
+  return std::move(b);
+}
+template<typename T, typename S>
+TDynamicMatrix<T, S> operator*(TDynamicMatrix<T, S>&& a, typename TDynamicMatrix<T, S>::value_type val)
+{
+  a *= val;
+  return std::move(a);
+}
+template<typename T, typename S>
+TDynamicMatrix<T, S> operator*(typename TDynamicMatrix<T, S>::value_type val, TDynamicMatrix<T, S>&& a)
+{
+  a *= val;
+  return std::move(a);
+}
+
 #endif
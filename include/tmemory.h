@@ -0,0 +1,322 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Выделение памяти под элементы векторов и матриц
+
+#ifndef __TMemory_H__
+#define __TMemory_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "tsimd.h"
+
+// Выравнивание памяти векторов и матриц по умолчанию:
+// строка кэша и ширина регистра AVX-512
+const size_t MEMORY_ALIGNMENT = 64;
+
+namespace memory_detail
+{
+  // Выравнивание блока от malloc/calloc: исходный указатель
+  // хранится непосредственно перед выровненным адресом
+  inline void* align_block(void* raw, size_t align)
+  {
+    if (raw == nullptr)
+      throw std::bad_alloc();
+    uintptr_t p = reinterpret_cast<uintptr_t>(raw) + sizeof(void*);
+    p = (p + align - 1) & ~uintptr_t(align - 1);
+    void* res = reinterpret_cast<void*>(p);
+    static_cast<void**>(res)[-1] = raw;
+    return res;
+  }
+  inline size_t block_size(size_t bytes, size_t align)
+  {
+    if (bytes > size_t(-1) - align - sizeof(void*))
+      throw std::bad_alloc();
+    return bytes + align + sizeof(void*);
+  }
+}
+
+// Блок памяти с выравниванием align (степень двойки)
+inline void* aligned_malloc(size_t bytes, size_t align)
+{
+  return memory_detail::align_block(std::malloc(memory_detail::block_size(bytes, align)), align);
+}
+// То же, но заполненный нулями. Большие блоки calloc берет у ОС (mmap)
+// уже обнуленными и не записывает их: страницы появляются при первом обращении
+inline void* aligned_calloc(size_t bytes, size_t align)
+{
+  return memory_detail::align_block(std::calloc(1, memory_detail::block_size(bytes, align)), align);
+}
+inline void aligned_free(void* p) noexcept
+{
+  if (p != nullptr)
+    std::free(static_cast<void**>(p)[-1]);
+}
+
+// Распределитель с выравниванием начала блока на Align байт.
+// allocate_zeroed(n) - память, уже заполненная нулями (см. alloc_create)
+template<typename T, size_t Align = MEMORY_ALIGNMENT>
+class TAlignedAllocator
+{
+public:
+  typedef T value_type;
+  template<typename U> struct rebind { typedef TAlignedAllocator<U, Align> other; };
+  static const size_t alignment = Align > alignof(T) ? Align : alignof(T);
+
+  TAlignedAllocator() noexcept {}
+  template<typename U>
+  TAlignedAllocator(const TAlignedAllocator<U, Align>&) noexcept {}
+
+  T* allocate(size_t n)
+  {
+    if (n > size_t(-1) / sizeof(T))
+      throw std::bad_alloc();
+    return static_cast<T*>(aligned_malloc(n * sizeof(T), alignment));
+  }
+  T* allocate_zeroed(size_t n)
+  {
+    if (n > size_t(-1) / sizeof(T))
+      throw std::bad_alloc();
+    return static_cast<T*>(aligned_calloc(n * sizeof(T), alignment));
+  }
+  void deallocate(T* p, size_t) noexcept
+  {
+    aligned_free(p);
+  }
+};
+template<typename T, typename U, size_t Align>
+bool operator==(const TAlignedAllocator<T, Align>&, const TAlignedAllocator<U, Align>&) noexcept { return true; }
+template<typename T, typename U, size_t Align>
+bool operator!=(const TAlignedAllocator<T, Align>&, const TAlignedAllocator<U, Align>&) noexcept { return false; }
+
+// Число элементов T в строке, дополненное так, чтобы каждая строка
+// начиналась с границы MEMORY_ALIGNMENT байт
+template<typename T>
+size_t aligned_stride(size_t n) noexcept
+{
+  const size_t w = MEMORY_ALIGNMENT % sizeof(T) == 0 ? MEMORY_ALIGNMENT / sizeof(T) : 1;
+  return (n + w - 1) / w * w;
+}
+
+// Память выделяется через распределитель Alloc со стандартным интерфейсом
+// (см. std::allocator_traits), указатель распределителя - обычный T*.
+// По умолчанию Alloc = TAlignedAllocator<T>: как new T[n], но начало
+// блока выровнено на MEMORY_ALIGNMENT
+
+// Тег конструкторов векторов и матриц: элементы не инициализируются
+// (для тривиальных T память остается как есть, для остальных работает
+// конструктор по умолчанию). Для памяти, которая сразу будет перезаписана
+struct TUninitialized {};
+const TUninitialized uninitialized = TUninitialized();
+
+// Есть ли у распределителя allocate_zeroed
+template<typename Alloc, typename = void>
+struct TAllocZeroed : std::false_type {};
+template<typename Alloc>
+struct TAllocZeroed<Alloc, decltype(void(std::declval<Alloc&>().allocate_zeroed(size_t())))> : std::true_type {};
+
+// Уничтожение n элементов и освобождение памяти под cap элементов
+template<typename Alloc>
+void alloc_destroy(Alloc& a, typename Alloc::value_type* p, size_t n, size_t cap) noexcept
+{
+  typedef std::allocator_traits<Alloc> traits;
+  if (p == nullptr)
+    return;
+  for (size_t i = 0; i < n; i++)
+    traits::destroy(a, p + i);
+  traits::deallocate(a, p, cap);
+}
+template<typename Alloc>
+void alloc_destroy(Alloc& a, typename Alloc::value_type* p, size_t n) noexcept
+{
+  alloc_destroy(a, p, n, n);
+}
+
+namespace memory_detail
+{
+  template<typename Alloc>
+  typename Alloc::value_type* create(Alloc& a, size_t n, std::false_type)
+  {
+    typedef std::allocator_traits<Alloc> traits;
+    typename Alloc::value_type* p = traits::allocate(a, n);
+    size_t i = 0;
+    try
+    {
+      for (; i < n; i++)
+        traits::construct(a, p + i);
+    }
+    catch (...)
+    {
+      alloc_destroy(a, p, i, n);
+      throw;
+    }
+    return p;
+  }
+  // для чисел T() - нулевые байты, их дает сам распределитель
+  template<typename Alloc>
+  typename Alloc::value_type* create(Alloc& a, size_t n, std::true_type)
+  {
+    return a.allocate_zeroed(n);
+  }
+}
+
+// n элементов T() - как new T[n]() (числа обнуляются)
+template<typename Alloc>
+typename Alloc::value_type* alloc_create(Alloc& a, size_t n)
+{
+  typedef typename Alloc::value_type T;
+  return memory_detail::create(a, n,
+    std::integral_constant<bool, std::is_arithmetic<T>::value && TAllocZeroed<Alloc>::value>());
+}
+
+// n элементов, созданных по умолчанию, - как new T[n] (числа не обнуляются);
+// для памяти, которая сразу будет перезаписана
+template<typename Alloc>
+typename Alloc::value_type* alloc_create_default(Alloc& a, size_t n)
+{
+  typedef typename Alloc::value_type T;
+  T* p = std::allocator_traits<Alloc>::allocate(a, n);
+  size_t i = 0;
+  try
+  {
+    for (; i < n; i++)
+      ::new (static_cast<void*>(p + i)) T;
+  }
+  catch (...)
+  {
+    alloc_destroy(a, p, i, n);
+    throw;
+  }
+  return p;
+}
+
+// Копии от STREAM_COPY_BYTES байт больше кэша последнего уровня:
+// они пишутся потоковыми командами мимо кэша и не вытесняют из него данные
+const size_t STREAM_COPY_BYTES = size_t(8) << 20;
+
+namespace memory_detail
+{
+#ifdef TMATRIX_SIMD_X86
+  // копирование с потоковой записью (SSE2 есть на любом x86-64)
+  inline void stream_copy(void* dst, const void* src, size_t bytes)
+  {
+    char* d = static_cast<char*>(dst);
+    const char* s = static_cast<const char*>(src);
+    size_t head = std::min(bytes, (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15);
+    std::memcpy(d, s, head);
+    d += head;
+    s += head;
+    bytes -= head;
+    size_t i = 0;
+    for (; i + 64 <= bytes; i += 64)
+    {
+      __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+      __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 16));
+      __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 32));
+      __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i + 48));
+      _mm_stream_si128(reinterpret_cast<__m128i*>(d + i), x0);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(d + i + 16), x1);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(d + i + 32), x2);
+      _mm_stream_si128(reinterpret_cast<__m128i*>(d + i + 48), x3);
+    }
+    std::memcpy(d + i, s + i, bytes - i);
+    _mm_sfence();
+  }
+#endif
+
+  template<typename T>
+  void copy_elements(const T* src, size_t n, T* dst, std::true_type)
+  {
+    size_t bytes = n * sizeof(T);
+#ifdef TMATRIX_SIMD_X86
+    if (bytes >= STREAM_COPY_BYTES)
+    {
+      stream_copy(dst, src, bytes);
+      return;
+    }
+#endif
+    std::memcpy(dst, src, bytes);
+  }
+  template<typename T>
+  void copy_elements(const T* src, size_t n, T* dst, std::false_type)
+  {
+    std::copy(src, src + n, dst);
+  }
+
+  template<typename T>
+  bool equal_elements(const T* a, const T* b, size_t n, std::true_type)
+  {
+    return std::memcmp(a, b, n * sizeof(T)) == 0;
+  }
+  template<typename T>
+  bool equal_elements(const T* a, const T* b, size_t n, std::false_type)
+  {
+    return std::equal(a, a + n, b);
+  }
+}
+
+// Копирование n элементов в непересекающуюся память:
+// для тривиально копируемых T - memcpy или потоковая запись
+template<typename T>
+void copy_elements(const T* src, size_t n, T* dst)
+{
+  memory_detail::copy_elements(src, n, dst, std::is_trivially_copyable<T>());
+}
+
+// Побайтовое сравнение верно для целых, перечислений и указателей,
+// но не для вещественных чисел (0.0 == -0.0, NaN != NaN)
+template<typename T>
+struct TBitwiseComparable
+  : std::integral_constant<bool, std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value> {};
+
+template<typename T>
+bool equal_elements(const T* a, const T* b, size_t n)
+{
+  return memory_detail::equal_elements(a, b, n, TBitwiseComparable<T>());
+}
+
+namespace memory_detail
+{
+  template<typename Alloc>
+  typename Alloc::value_type* copy(Alloc& a, const typename Alloc::value_type* src, size_t n, std::false_type)
+  {
+    typedef std::allocator_traits<Alloc> traits;
+    typename Alloc::value_type* p = traits::allocate(a, n);
+    size_t i = 0;
+    try
+    {
+      for (; i < n; i++)
+        traits::construct(a, p + i, src[i]);
+    }
+    catch (...)
+    {
+      alloc_destroy(a, p, i, n);
+      throw;
+    }
+    return p;
+  }
+  template<typename Alloc>
+  typename Alloc::value_type* copy(Alloc& a, const typename Alloc::value_type* src, size_t n, std::true_type)
+  {
+    typename Alloc::value_type* p = std::allocator_traits<Alloc>::allocate(a, n);
+    ::copy_elements(src, n, p);
+    return p;
+  }
+}
+
+// копия n элементов src
+template<typename Alloc>
+typename Alloc::value_type* alloc_copy(Alloc& a, const typename Alloc::value_type* src, size_t n)
+{
+  return memory_detail::copy(a, src, n, std::is_trivially_copyable<typename Alloc::value_type>());
+}
+
+#endif
@@ -0,0 +1,547 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Векторизованные ядра поэлементных операций и скалярного произведения
+// с выбором набора инструкций во время выполнения
+
+#ifndef __TSimd_H__
+#define __TSimd_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TMATRIX_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Области кода, компилируемые для заданного набора инструкций
+// независимо от ключей компилятора (MSVC допускает интринсики без ключей)
+#if defined(__clang__)
+#define TMATRIX_TARGET_PUSH_SSE42 _Pragma("clang attribute push(__attribute__((target(\"sse4.2\"))), apply_to = function)")
+#define TMATRIX_TARGET_PUSH_AVX2 _Pragma("clang attribute push(__attribute__((target(\"avx2,fma\"))), apply_to = function)")
+#define TMATRIX_TARGET_PUSH_AVX512 _Pragma("clang attribute push(__attribute__((target(\"avx512f,avx512dq,avx2,fma\"))), apply_to = function)")
+#define TMATRIX_TARGET_POP _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define TMATRIX_TARGET_PUSH_SSE42 _Pragma("GCC push_options") _Pragma("GCC target(\"sse4.2\")")
+#define TMATRIX_TARGET_PUSH_AVX2 _Pragma("GCC push_options") _Pragma("GCC target(\"avx2,fma\")")
+#define TMATRIX_TARGET_PUSH_AVX512 _Pragma("GCC push_options") _Pragma("GCC target(\"avx512f,avx512dq,avx2,fma\")")
+#define TMATRIX_TARGET_POP _Pragma("GCC pop_options")
+#else
+#define TMATRIX_TARGET_PUSH_SSE42
+#define TMATRIX_TARGET_PUSH_AVX2
+#define TMATRIX_TARGET_PUSH_AVX512
+#define TMATRIX_TARGET_POP
+#endif
+
+// Наборы векторных инструкций в порядке возрастания
+enum TSimdLevel
+{
+  SIMD_SCALAR = 0,
+  SIMD_SSE42 = 1,
+  SIMD_AVX2 = 2,    // AVX2 + FMA
+  SIMD_AVX512 = 3,  // AVX-512F + AVX-512DQ
+  SIMD_LEVELS = 4
+};
+
+// Определение возможностей процессора (cpuid) и поддержки регистров ОС (xgetbv)
+inline TSimdLevel detect_simd_level()
+{
+#ifdef TMATRIX_SIMD_X86
+  unsigned r1[4] = { 0, 0, 0, 0 }, r7[4] = { 0, 0, 0, 0 };
+  unsigned long long xcr0 = 0;
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  int maxLeaf = info[0];
+  __cpuid(info, 1);
+  for (int i = 0; i < 4; i++) r1[i] = unsigned(info[i]);
+  if (maxLeaf >= 7)
+  {
+    __cpuidex(info, 7, 0);
+    for (int i = 0; i < 4; i++) r7[i] = unsigned(info[i]);
+  }
+  if (r1[2] & (1u << 27))
+    xcr0 = _xgetbv(0);
+#else
+  unsigned maxLeaf = __get_cpuid_max(0, nullptr);
+  __get_cpuid(1, &r1[0], &r1[1], &r1[2], &r1[3]);
+  if (maxLeaf >= 7)
+    __cpuid_count(7, 0, r7[0], r7[1], r7[2], r7[3]);
+  if (r1[2] & (1u << 27))
+  {
+    unsigned lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    xcr0 = (unsigned long long)hi << 32 | lo;
+  }
+#endif
+  bool sse42 = (r1[2] & (1u << 20)) != 0;
+  bool osAvx = (xcr0 & 0x6) == 0x6;           // XMM и YMM сохраняются ОС
+  bool osAvx512 = (xcr0 & 0xE6) == 0xE6;      // а также opmask и ZMM
+  bool avx2 = osAvx && (r1[2] & (1u << 28)) && (r1[2] & (1u << 12)) && (r7[1] & (1u << 5));
+  bool avx512 = avx2 && osAvx512 && (r7[1] & (1u << 16)) && (r7[1] & (1u << 17));
+  if (avx512)
+    return SIMD_AVX512;
+  if (avx2)
+    return SIMD_AVX2;
+  if (sse42)
+    return SIMD_SSE42;
+#endif
+  return SIMD_SCALAR;
+}
+
+// Наилучший набор, доступный на этом процессоре (определяется один раз)
+inline TSimdLevel max_simd_level()
+{
+  static const TSimdLevel level = detect_simd_level();
+  return level;
+}
+
+namespace simd_detail
+{
+  inline std::atomic<int>& current_level()
+  {
+    static std::atomic<int> level(max_simd_level());
+    return level;
+  }
+}
+
+// Набор, через который сейчас идут вычисления
+inline TSimdLevel simd_level()
+{
+  return TSimdLevel(simd_detail::current_level().load(std::memory_order_relaxed));
+}
+
+// Ограничение набора инструкций (например, для сравнения ядер);
+// выше возможностей процессора подняться нельзя
+inline void set_simd_level(TSimdLevel level)
+{
+  if (level > max_simd_level())
+    level = max_simd_level();
+  simd_detail::current_level() = level;
+}
+
+inline const char* simd_level_name(TSimdLevel level)
+{
+  switch (level)
+  {
+  case SIMD_SSE42: return "sse4.2";
+  case SIMD_AVX2: return "avx2";
+  case SIMD_AVX512: return "avx512";
+  default: return "scalar";
+  }
+}
+inline const char* simd_level_name()
+{
+  return simd_level_name(simd_level());
+}
+
+// Таблица ядер для одного набора инструкций
+template<typename T>
+struct TVectorKernels
+{
+  void (*add)(const T*, const T*, T*, size_t);
+  void (*sub)(const T*, const T*, T*, size_t);
+  void (*add_scalar)(const T*, T, T*, size_t);
+  void (*sub_scalar)(const T*, T, T*, size_t);
+  void (*mul_scalar)(const T*, T, T*, size_t);
+  void (*axpy)(T, const T*, T*, size_t);
+  T (*dot)(const T*, const T*, size_t);
+  T (*dot_axpy)(T, const T*, const T*, T*, size_t);
+};
+
+// Ядра без векторных инструкций - обычные циклы, подходят для любого T
+namespace simd_scalar
+{
+  template<typename T>
+  void add(const T* a, const T* b, T* r, size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+      r[i] = a[i] + b[i];
+  }
+  template<typename T>
+  void sub(const T* a, const T* b, T* r, size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+      r[i] = a[i] - b[i];
+  }
+  template<typename T>
+  void add_scalar(const T* a, T val, T* r, size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+      r[i] = a[i] + val;
+  }
+  template<typename T>
+  void sub_scalar(const T* a, T val, T* r, size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+      r[i] = a[i] - val;
+  }
+  template<typename T>
+  void mul_scalar(const T* a, T val, T* r, size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+      r[i] = a[i] * val;
+  }
+  template<typename T>
+  void axpy(T alpha, const T* x, T* y, size_t n)
+  {
+    for (size_t i = 0; i < n; i++)
+      y[i] += alpha * x[i];
+  }
+  template<typename T>
+  T dot(const T* a, const T* b, size_t n)
+  {
+    T res = T();
+    for (size_t i = 0; i < n; i++)
+      res += a[i] * b[i];
+    return res;
+  }
+  template<typename T>
+  T dot_axpy(T alpha, const T* a, const T* x, T* y, size_t n)
+  {
+    T res = T();
+    for (size_t i = 0; i < n; i++)
+    {
+      res += a[i] * x[i];
+      y[i] += alpha * a[i];
+    }
+    return res;
+  }
+
+  template<typename T>
+  TVectorKernels<T> kernels()
+  {
+    TVectorKernels<T> k = { &add<T>, &sub<T>, &add_scalar<T>, &sub_scalar<T>, &mul_scalar<T>, &axpy<T>, &dot<T>,
+      &dot_axpy<T> };
+    return k;
+  }
+}
+
+#ifdef TMATRIX_SIMD_X86
+
+TMATRIX_TARGET_PUSH_SSE42
+namespace simd_sse42
+{
+  template<typename T> struct TReg;
+
+  template<> struct TReg<float>
+  {
+    typedef float T; typedef __m128 reg; static const size_t W = 4;
+    static reg load(const T* p) { return _mm_loadu_ps(p); }
+    static void store(T* p, reg x) { _mm_storeu_ps(p, x); }
+    static reg set1(T v) { return _mm_set1_ps(v); }
+    static reg zero() { return _mm_setzero_ps(); }
+    static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static T reduce(reg s)
+    {
+      s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+      s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+      return _mm_cvtss_f32(s);
+    }
+  };
+
+  template<> struct TReg<double>
+  {
+    typedef double T; typedef __m128d reg; static const size_t W = 2;
+    static reg load(const T* p) { return _mm_loadu_pd(p); }
+    static void store(T* p, reg x) { _mm_storeu_pd(p, x); }
+    static reg set1(T v) { return _mm_set1_pd(v); }
+    static reg zero() { return _mm_setzero_pd(); }
+    static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static T reduce(reg s) { return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s))); }
+  };
+
+  template<> struct TReg<int32_t>
+  {
+    typedef int32_t T; typedef __m128i reg; static const size_t W = 4;
+    static reg load(const T* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(T* p, reg x) { _mm_storeu_si128((__m128i*)p, x); }
+    static reg set1(T v) { return _mm_set1_epi32(v); }
+    static reg zero() { return _mm_setzero_si128(); }
+    static reg add(reg a, reg b) { return _mm_add_epi32(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_epi32(a, b); }
+    static reg mul(reg a, reg b) { return _mm_mullo_epi32(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm_add_epi32(_mm_mullo_epi32(a, b), c); }
+    static T reduce(reg s)
+    {
+      s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+      s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+      return _mm_cvtsi128_si32(s);
+    }
+  };
+
+  template<> struct TReg<int64_t>
+  {
+    typedef int64_t T; typedef __m128i reg; static const size_t W = 2;
+    static reg load(const T* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(T* p, reg x) { _mm_storeu_si128((__m128i*)p, x); }
+    static reg set1(T v) { return _mm_set1_epi64x(v); }
+    static reg zero() { return _mm_setzero_si128(); }
+    static reg add(reg a, reg b) { return _mm_add_epi64(a, b); }
+    static reg sub(reg a, reg b) { return _mm_sub_epi64(a, b); }
+    // 64-битное умножение из 32-битных половин (по модулю 2^64)
+    static reg mul(reg a, reg b)
+    {
+      reg lo = _mm_mul_epu32(a, b);
+      reg cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b),
+                                _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+      return _mm_add_epi64(lo, _mm_slli_epi64(cross, 32));
+    }
+    static reg fma(reg a, reg b, reg c) { return _mm_add_epi64(mul(a, b), c); }
+    static T reduce(reg s) { return _mm_cvtsi128_si64(_mm_add_epi64(s, _mm_unpackhi_epi64(s, s))); }
+  };
+
+#include "tsimd_kernels.h"
+}
+TMATRIX_TARGET_POP
+
+TMATRIX_TARGET_PUSH_AVX2
+namespace simd_avx2
+{
+  template<typename T> struct TReg;
+
+  template<> struct TReg<float>
+  {
+    typedef float T; typedef __m256 reg; static const size_t W = 8;
+    static reg load(const T* p) { return _mm256_loadu_ps(p); }
+    static void store(T* p, reg x) { _mm256_storeu_ps(p, x); }
+    static reg set1(T v) { return _mm256_set1_ps(v); }
+    static reg zero() { return _mm256_setzero_ps(); }
+    static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm256_fmadd_ps(a, b, c); }
+    static T reduce(reg x)
+    {
+      __m128 s = _mm_add_ps(_mm256_castps256_ps128(x), _mm256_extractf128_ps(x, 1));
+      s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+      s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+      return _mm_cvtss_f32(s);
+    }
+  };
+
+  template<> struct TReg<double>
+  {
+    typedef double T; typedef __m256d reg; static const size_t W = 4;
+    static reg load(const T* p) { return _mm256_loadu_pd(p); }
+    static void store(T* p, reg x) { _mm256_storeu_pd(p, x); }
+    static reg set1(T v) { return _mm256_set1_pd(v); }
+    static reg zero() { return _mm256_setzero_pd(); }
+    static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm256_fmadd_pd(a, b, c); }
+    static T reduce(reg x)
+    {
+      __m128d s = _mm_add_pd(_mm256_castpd256_pd128(x), _mm256_extractf128_pd(x, 1));
+      return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    }
+  };
+
+  template<> struct TReg<int32_t>
+  {
+    typedef int32_t T; typedef __m256i reg; static const size_t W = 8;
+    static reg load(const T* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(T* p, reg x) { _mm256_storeu_si256((__m256i*)p, x); }
+    static reg set1(T v) { return _mm256_set1_epi32(v); }
+    static reg zero() { return _mm256_setzero_si256(); }
+    static reg add(reg a, reg b) { return _mm256_add_epi32(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_epi32(a, b); }
+    static reg mul(reg a, reg b) { return _mm256_mullo_epi32(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm256_add_epi32(_mm256_mullo_epi32(a, b), c); }
+    static T reduce(reg x)
+    {
+      __m128i s = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+      s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+      s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+      return _mm_cvtsi128_si32(s);
+    }
+  };
+
+  template<> struct TReg<int64_t>
+  {
+    typedef int64_t T; typedef __m256i reg; static const size_t W = 4;
+    static reg load(const T* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(T* p, reg x) { _mm256_storeu_si256((__m256i*)p, x); }
+    static reg set1(T v) { return _mm256_set1_epi64x(v); }
+    static reg zero() { return _mm256_setzero_si256(); }
+    static reg add(reg a, reg b) { return _mm256_add_epi64(a, b); }
+    static reg sub(reg a, reg b) { return _mm256_sub_epi64(a, b); }
+    // в AVX2 нет 64-битного умножения: собираем его из 32-битных половин (по модулю 2^64)
+    static reg mul(reg a, reg b)
+    {
+      reg lo = _mm256_mul_epu32(a, b);
+      reg cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                                   _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+      return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+    }
+    static reg fma(reg a, reg b, reg c) { return _mm256_add_epi64(mul(a, b), c); }
+    static T reduce(reg x)
+    {
+      __m128i s = _mm_add_epi64(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+      return _mm_cvtsi128_si64(_mm_add_epi64(s, _mm_unpackhi_epi64(s, s)));
+    }
+  };
+
+#include "tsimd_kernels.h"
+}
+TMATRIX_TARGET_POP
+
+TMATRIX_TARGET_PUSH_AVX512
+namespace simd_avx512
+{
+  template<typename T> struct TReg;
+
+  template<> struct TReg<float>
+  {
+    typedef float T; typedef __m512 reg; static const size_t W = 16;
+    static reg load(const T* p) { return _mm512_loadu_ps(p); }
+    static void store(T* p, reg x) { _mm512_storeu_ps(p, x); }
+    static reg set1(T v) { return _mm512_set1_ps(v); }
+    static reg zero() { return _mm512_setzero_ps(); }
+    static reg add(reg a, reg b) { return _mm512_add_ps(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_ps(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mul_ps(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm512_fmadd_ps(a, b, c); }
+    static T reduce(reg x)
+    {
+      return simd_avx2::TReg<float>::reduce(
+        _mm256_add_ps(_mm512_castps512_ps256(x), _mm512_extractf32x8_ps(x, 1)));
+    }
+  };
+
+  template<> struct TReg<double>
+  {
+    typedef double T; typedef __m512d reg; static const size_t W = 8;
+    static reg load(const T* p) { return _mm512_loadu_pd(p); }
+    static void store(T* p, reg x) { _mm512_storeu_pd(p, x); }
+    static reg set1(T v) { return _mm512_set1_pd(v); }
+    static reg zero() { return _mm512_setzero_pd(); }
+    static reg add(reg a, reg b) { return _mm512_add_pd(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_pd(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mul_pd(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm512_fmadd_pd(a, b, c); }
+    static T reduce(reg x)
+    {
+      return simd_avx2::TReg<double>::reduce(
+        _mm256_add_pd(_mm512_castpd512_pd256(x), _mm512_extractf64x4_pd(x, 1)));
+    }
+  };
+
+  template<> struct TReg<int32_t>
+  {
+    typedef int32_t T; typedef __m512i reg; static const size_t W = 16;
+    static reg load(const T* p) { return _mm512_loadu_si512(p); }
+    static void store(T* p, reg x) { _mm512_storeu_si512(p, x); }
+    static reg set1(T v) { return _mm512_set1_epi32(v); }
+    static reg zero() { return _mm512_setzero_si512(); }
+    static reg add(reg a, reg b) { return _mm512_add_epi32(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_epi32(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mullo_epi32(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm512_add_epi32(_mm512_mullo_epi32(a, b), c); }
+    static T reduce(reg x)
+    {
+      return simd_avx2::TReg<int32_t>::reduce(
+        _mm256_add_epi32(_mm512_castsi512_si256(x), _mm512_extracti64x4_epi64(x, 1)));
+    }
+  };
+
+  template<> struct TReg<int64_t>
+  {
+    typedef int64_t T; typedef __m512i reg; static const size_t W = 8;
+    static reg load(const T* p) { return _mm512_loadu_si512(p); }
+    static void store(T* p, reg x) { _mm512_storeu_si512(p, x); }
+    static reg set1(T v) { return _mm512_set1_epi64(v); }
+    static reg zero() { return _mm512_setzero_si512(); }
+    static reg add(reg a, reg b) { return _mm512_add_epi64(a, b); }
+    static reg sub(reg a, reg b) { return _mm512_sub_epi64(a, b); }
+    static reg mul(reg a, reg b) { return _mm512_mullo_epi64(a, b); }
+    static reg fma(reg a, reg b, reg c) { return _mm512_add_epi64(_mm512_mullo_epi64(a, b), c); }
+    static T reduce(reg x)
+    {
+      return simd_avx2::TReg<int64_t>::reduce(
+        _mm256_add_epi64(_mm512_castsi512_si256(x), _mm512_extracti64x4_epi64(x, 1)));
+    }
+  };
+
+#include "tsimd_kernels.h"
+}
+TMATRIX_TARGET_POP
+
+#endif // TMATRIX_SIMD_X86
+
+// Таблица ядер для текущего набора инструкций
+template<typename T>
+const TVectorKernels<T>& vector_kernels()
+{
+  static const TVectorKernels<T> table[SIMD_LEVELS] = {
+    simd_scalar::kernels<T>(),
+#ifdef TMATRIX_SIMD_X86
+    simd_sse42::kernels<T>(),
+    simd_avx2::kernels<T>(),
+    simd_avx512::kernels<T>()
+#else
+    simd_scalar::kernels<T>(),
+    simd_scalar::kernels<T>(),
+    simd_scalar::kernels<T>()
+#endif
+  };
+  return table[simd_level()];
+}
+
+// Ядра операций над массивами: r = a + b, r = a - b, r = a + val, r = a - val,
+// r = a * val, y = alpha * x + y, a . b, а также a . x с y = alpha * a + y за один проход
+// Для float, double, int32_t и int64_t вызов идет через таблицу лучших ядер
+// для данного процессора, для остальных типов - обычные циклы
+namespace simd
+{
+  using simd_scalar::add;
+  using simd_scalar::sub;
+  using simd_scalar::add_scalar;
+  using simd_scalar::sub_scalar;
+  using simd_scalar::mul_scalar;
+  using simd_scalar::axpy;
+  using simd_scalar::dot;
+  using simd_scalar::dot_axpy;
+
+#define TMATRIX_SIMD_DISPATCH(T)                                                \
+  inline void add(const T* a, const T* b, T* r, size_t n)                       \
+  { vector_kernels<T>().add(a, b, r, n); }                                      \
+  inline void sub(const T* a, const T* b, T* r, size_t n)                       \
+  { vector_kernels<T>().sub(a, b, r, n); }                                      \
+  inline void add_scalar(const T* a, T val, T* r, size_t n)                     \
+  { vector_kernels<T>().add_scalar(a, val, r, n); }                             \
+  inline void sub_scalar(const T* a, T val, T* r, size_t n)                     \
+  { vector_kernels<T>().sub_scalar(a, val, r, n); }                             \
+  inline void mul_scalar(const T* a, T val, T* r, size_t n)                     \
+  { vector_kernels<T>().mul_scalar(a, val, r, n); }                             \
+  inline void axpy(T alpha, const T* x, T* y, size_t n)                         \
+  { vector_kernels<T>().axpy(alpha, x, y, n); }                                 \
+  inline T dot(const T* a, const T* b, size_t n)                                \
+  { return vector_kernels<T>().dot(a, b, n); }                                  \
+  inline T dot_axpy(T alpha, const T* a, const T* x, T* y, size_t n)            \
+  { return vector_kernels<T>().dot_axpy(alpha, a, x, y, n); }
+
+  TMATRIX_SIMD_DISPATCH(float)
+  TMATRIX_SIMD_DISPATCH(double)
+  TMATRIX_SIMD_DISPATCH(int32_t)
+  TMATRIX_SIMD_DISPATCH(int64_t)
+
+#undef TMATRIX_SIMD_DISPATCH
+}
+
+#endif
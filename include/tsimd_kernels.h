@@ -0,0 +1,137 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Обобщенные векторные ядра.
+// Файл без защиты от повторного включения: tsimd.h включает его
+// несколько раз, внутри пространства имен и области target каждого набора инструкций.
+// TReg<T> - набор операций над регистром из W элементов типа T.
+// Хвост, не кратный ширине регистра, обрабатывается поэлементно
+
+template<typename V>
+void add(const typename V::T* a, const typename V::T* b, typename V::T* r, size_t n)
+{
+  size_t i = 0;
+  for (; i + V::W <= n; i += V::W)
+    V::store(r + i, V::add(V::load(a + i), V::load(b + i)));
+  for (; i < n; i++)
+    r[i] = a[i] + b[i];
+}
+
+template<typename V>
+void sub(const typename V::T* a, const typename V::T* b, typename V::T* r, size_t n)
+{
+  size_t i = 0;
+  for (; i + V::W <= n; i += V::W)
+    V::store(r + i, V::sub(V::load(a + i), V::load(b + i)));
+  for (; i < n; i++)
+    r[i] = a[i] - b[i];
+}
+
+template<typename V>
+void add_scalar(const typename V::T* a, typename V::T val, typename V::T* r, size_t n)
+{
+  typename V::reg vv = V::set1(val);
+  size_t i = 0;
+  for (; i + V::W <= n; i += V::W)
+    V::store(r + i, V::add(V::load(a + i), vv));
+  for (; i < n; i++)
+    r[i] = a[i] + val;
+}
+
+template<typename V>
+void sub_scalar(const typename V::T* a, typename V::T val, typename V::T* r, size_t n)
+{
+  typename V::reg vv = V::set1(val);
+  size_t i = 0;
+  for (; i + V::W <= n; i += V::W)
+    V::store(r + i, V::sub(V::load(a + i), vv));
+  for (; i < n; i++)
+    r[i] = a[i] - val;
+}
+
+template<typename V>
+void mul_scalar(const typename V::T* a, typename V::T val, typename V::T* r, size_t n)
+{
+  typename V::reg vv = V::set1(val);
+  size_t i = 0;
+  for (; i + V::W <= n; i += V::W)
+    V::store(r + i, V::mul(V::load(a + i), vv));
+  for (; i < n; i++)
+    r[i] = a[i] * val;
+}
+
+template<typename V>
+void axpy(typename V::T alpha, const typename V::T* x, typename V::T* y, size_t n)
+{
+  typename V::reg va = V::set1(alpha);
+  size_t i = 0;
+  for (; i + V::W <= n; i += V::W)
+    V::store(y + i, V::fma(va, V::load(x + i), V::load(y + i)));
+  for (; i < n; i++)
+    y[i] += alpha * x[i];
+}
+
+// четыре независимых аккумулятора скрывают задержку умножения-сложения
+template<typename V>
+typename V::T dot(const typename V::T* a, const typename V::T* b, size_t n)
+{
+  typedef typename V::reg reg;
+  const size_t W = V::W;
+  reg s0 = V::zero(), s1 = V::zero(), s2 = V::zero(), s3 = V::zero();
+  size_t i = 0;
+  for (; i + 4 * W <= n; i += 4 * W)
+  {
+    s0 = V::fma(V::load(a + i), V::load(b + i), s0);
+    s1 = V::fma(V::load(a + i + W), V::load(b + i + W), s1);
+    s2 = V::fma(V::load(a + i + 2 * W), V::load(b + i + 2 * W), s2);
+    s3 = V::fma(V::load(a + i + 3 * W), V::load(b + i + 3 * W), s3);
+  }
+  for (; i + W <= n; i += W)
+    s0 = V::fma(V::load(a + i), V::load(b + i), s0);
+  typename V::T res = V::reduce(V::add(V::add(s0, s1), V::add(s2, s3)));
+  for (; i < n; i++)
+    res += a[i] * b[i];
+  return res;
+}
+
+// скалярное произведение a . x и y = alpha * a + y за одно чтение a
+template<typename V>
+typename V::T dot_axpy(typename V::T alpha, const typename V::T* a, const typename V::T* x,
+  typename V::T* y, size_t n)
+{
+  typedef typename V::reg reg;
+  const size_t W = V::W;
+  reg va = V::set1(alpha);
+  reg s0 = V::zero(), s1 = V::zero();
+  size_t i = 0;
+  for (; i + 2 * W <= n; i += 2 * W)
+  {
+    reg a0 = V::load(a + i), a1 = V::load(a + i + W);
+    s0 = V::fma(a0, V::load(x + i), s0);
+    s1 = V::fma(a1, V::load(x + i + W), s1);
+    V::store(y + i, V::fma(va, a0, V::load(y + i)));
+    V::store(y + i + W, V::fma(va, a1, V::load(y + i + W)));
+  }
+  for (; i + W <= n; i += W)
+  {
+    reg a0 = V::load(a + i);
+    s0 = V::fma(a0, V::load(x + i), s0);
+    V::store(y + i, V::fma(va, a0, V::load(y + i)));
+  }
+  typename V::T res = V::reduce(V::add(s0, s1));
+  for (; i < n; i++)
+  {
+    res += a[i] * x[i];
+    y[i] += alpha * a[i];
+  }
+  return res;
+}
+
+template<typename T>
+TVectorKernels<T> kernels()
+{
+  TVectorKernels<T> k = { &add<TReg<T>>, &sub<TReg<T>>, &add_scalar<TReg<T>>,
+    &sub_scalar<TReg<T>>, &mul_scalar<TReg<T>>, &axpy<TReg<T>>, &dot<TReg<T>>, &dot_axpy<TReg<T>> };
+  return k;
+}
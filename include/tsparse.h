@@ -0,0 +1,831 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Разреженные матрицы в форматах CSR (compressed sparse row),
+// SELL-C-sigma (sliced ELLPACK) и BSR (block sparse row)
+
+#ifndef __TSparse_H__
+#define __TSparse_H__
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <utility>
+#include "tmatrix.h"
+
+// Число ненулевых элементов, начиная с которого умножение на вектор
+// распределяется по потокам
+const size_t SPARSE_PARALLEL_THRESHOLD = 1 << 16;
+
+// Элемент разреженной матрицы: строка, столбец, значение
+template<typename T>
+struct TTriplet
+{
+  size_t row, col;
+  T value;
+};
+
+// Разреженная матрица r x c в формате CSR: ненулевые элементы строки i
+// лежат в col[ptr[i]..ptr[i + 1]) (номера столбцов по возрастанию) и val.
+// Размеры ограничены MAX_VECTOR_SIZE, а не MAX_MATRIX_SIZE: память
+// пропорциональна числу ненулевых элементов. В выражениях с плотными
+// матрицами участвует как обычная матрица с нулями
+template<typename T, typename Alloc = TAlignedAllocator<T>>
+class TCsrMatrix : public TMatExpr<TCsrMatrix<T, Alloc>>
+{
+  size_t nr, nc;
+  std::vector<size_t> ptr;
+  std::vector<uint32_t> col;
+  std::vector<T, Alloc> val;
+
+  static size_t check_size(size_t s)
+  {
+    if (s == 0)
+      throw out_of_range("Matrix size should be greater than zero");
+    if (s > MAX_VECTOR_SIZE)
+      throw out_of_range("Matrix size should not exceed MAX_VECTOR_SIZE");
+    return s;
+  }
+  // элементы строки: сортировка по столбцу и сложение повторяющихся
+  void compress(std::vector<std::pair<uint32_t, T>>& items)
+  {
+    size_t nnz = 0;
+    for (size_t i = 0; i < nr; i++)
+    {
+      auto first = items.begin() + ptr[i], last = items.begin() + ptr[i + 1];
+      std::sort(first, last, [](const std::pair<uint32_t, T>& a, const std::pair<uint32_t, T>& b)
+        { return a.first < b.first; });
+      ptr[i] = nnz;
+      for (auto it = first; it != last; ++it)
+        if (nnz > ptr[i] && col[nnz - 1] == it->first)
+          val[nnz - 1] += it->second;
+        else
+        {
+          col[nnz] = it->first;
+          val[nnz++] = it->second;
+        }
+    }
+    ptr[nr] = nnz;
+    col.resize(nnz);
+    val.resize(nnz);
+  }
+  // a Op b слиянием строк; элементы, ставшие нулями, остаются в структуре
+  template<typename Op>
+  static TCsrMatrix merge(const TCsrMatrix& a, const TCsrMatrix& b)
+  {
+    if (a.nr != b.nr || a.nc != b.nc)
+      throw length_error("Matrices should have equal sizes");
+    TCsrMatrix res(a.nr, a.nc, a.get_allocator());
+    res.col.reserve(a.nonzeros() + b.nonzeros());
+    res.val.reserve(a.nonzeros() + b.nonzeros());
+    for (size_t i = 0; i < a.nr; i++)
+    {
+      size_t p = a.ptr[i], pe = a.ptr[i + 1], q = b.ptr[i], qe = b.ptr[i + 1];
+      while (p < pe || q < qe)
+      {
+        uint32_t j = q == qe || (p < pe && a.col[p] < b.col[q]) ? a.col[p] : b.col[q];
+        T x = p < pe && a.col[p] == j ? a.val[p++] : T();
+        T y = q < qe && b.col[q] == j ? b.val[q++] : T();
+        res.col.push_back(j);
+        res.val.push_back(Op::at(x, y));
+      }
+      res.ptr[i + 1] = res.col.size();
+    }
+    return res;
+  }
+  // C = A * B по строкам (алгоритм Густавсона) в две фазы. Символьная
+  // считает число элементов каждой строки C, после чего память результата
+  // выделяется один раз точно по размеру. Численная накапливает строку
+  // в плотном аккумуляторе длины cols(B) (SPA) с пометками занятых столбцов.
+  // Строки делятся между потоками по числу умножений, у каждой части свои SPA
+  // и пометки, выделяемые один раз на обе фазы
+  static TCsrMatrix multiply(const TCsrMatrix& a, const TCsrMatrix& b)
+  {
+    if (a.nc != b.nr)
+      throw length_error("Matrix column count should be equal to row count of the second matrix");
+    TCsrMatrix c(a.nr, b.nc, a.get_allocator());
+    std::vector<size_t> work(a.nr + 1);
+    for (size_t i = 0; i < a.nr; i++)
+    {
+      size_t w = 0;
+      for (size_t k = a.ptr[i]; k < a.ptr[i + 1]; k++)
+        w += b.ptr[a.col[k] + 1] - b.ptr[a.col[k]];
+      work[i + 1] = work[i] + w;
+    }
+    size_t parts = work[a.nr] < SPARSE_PARALLEL_THRESHOLD ? 1 : thread_pool().size();
+    std::vector<size_t> bounds(parts + 1, a.nr);
+    for (size_t p = 0; p < parts; p++)
+      bounds[p] = std::lower_bound(work.begin(), work.end() - 1, work[a.nr] / parts * p) - work.begin();
+    auto run = [&](const std::function<void(size_t)>& f)
+    {
+      if (parts == 1)
+        f(0);
+      else
+        thread_pool().parallel_for(parts, f);
+    };
+    // номер строки не больше MAX_VECTOR_SIZE и не совпадает с UINT32_MAX
+    std::vector<std::vector<uint32_t>> marks(parts);
+    std::vector<std::vector<T>> accs(parts);
+
+    // символьная фаза: mark[j] == i - столбец j уже встречался в строке i
+    run([&](size_t p)
+    {
+      std::vector<uint32_t>& mark = marks[p];
+      mark.assign(b.nc, UINT32_MAX);
+      accs[p].resize(b.nc);
+      for (size_t i = bounds[p]; i < bounds[p + 1]; i++)
+      {
+        size_t cnt = 0;
+        for (size_t k = a.ptr[i]; k < a.ptr[i + 1]; k++)
+          for (size_t q = b.ptr[a.col[k]]; q < b.ptr[a.col[k] + 1]; q++)
+            if (mark[b.col[q]] != uint32_t(i))
+            {
+              mark[b.col[q]] = uint32_t(i);
+              cnt++;
+            }
+        c.ptr[i + 1] = cnt;
+      }
+    });
+    for (size_t i = 0; i < a.nr; i++)
+      c.ptr[i + 1] += c.ptr[i];
+    c.col.resize(c.ptr[a.nr]);
+    c.val.resize(c.ptr[a.nr]);
+
+    // численная фаза: столбцы строки собираются прямо в c.col и сортируются
+    run([&](size_t p)
+    {
+      std::vector<uint32_t>& mark = marks[p];
+      std::vector<T>& acc = accs[p];
+      std::fill(mark.begin(), mark.end(), UINT32_MAX);
+      for (size_t i = bounds[p]; i < bounds[p + 1]; i++)
+      {
+        uint32_t* cols = c.col.data() + c.ptr[i];
+        size_t cnt = 0;
+        for (size_t k = a.ptr[i]; k < a.ptr[i + 1]; k++)
+        {
+          T aik = a.val[k];
+          for (size_t q = b.ptr[a.col[k]]; q < b.ptr[a.col[k] + 1]; q++)
+          {
+            uint32_t j = b.col[q];
+            if (mark[j] != uint32_t(i))
+            {
+              mark[j] = uint32_t(i);
+              acc[j] = aik * b.val[q];
+              cols[cnt++] = j;
+            }
+            else
+              acc[j] += aik * b.val[q];
+          }
+        }
+        std::sort(cols, cols + cnt);
+        T* vals = c.val.data() + c.ptr[i];
+        for (size_t t = 0; t < cnt; t++)
+          vals[t] = acc[cols[t]];
+      }
+    });
+    return c;
+  }
+public:
+  typedef T value_type;
+  typedef TDynamicMatrix<T> matrix_type;
+  typedef Alloc allocator_type;
+
+  // матрица без ненулевых элементов
+  TCsrMatrix(size_t r = 1, size_t c = 1, const Alloc& a = Alloc())
+    : nr(check_size(r)), nc(check_size(c)), ptr(r + 1), val(a)
+  {
+  }
+  // из списка (строка, столбец, значение) в любом порядке;
+  // значения с одинаковыми индексами складываются
+  TCsrMatrix(size_t r, size_t c, const std::vector<TTriplet<T>>& items, const Alloc& a = Alloc())
+    : nr(check_size(r)), nc(check_size(c)), ptr(r + 1), col(items.size()), val(items.size(), T(), a)
+  {
+    for (const TTriplet<T>& t : items)
+    {
+      if (t.row >= nr || t.col >= nc)
+        throw out_of_range("Matrix index is out of range");
+      ptr[t.row + 1]++;
+    }
+    for (size_t i = 0; i < nr; i++)
+      ptr[i + 1] += ptr[i];
+    // раскладка по строкам: next[i] - следующая свободная позиция строки i
+    std::vector<size_t> next(ptr.begin(), ptr.end() - 1);
+    std::vector<std::pair<uint32_t, T>> tmp(items.size());
+    for (const TTriplet<T>& t : items)
+      tmp[next[t.row]++] = std::make_pair(uint32_t(t.col), t.value);
+    compress(tmp);
+  }
+  // ненулевые элементы выражения
+  template<typename E>
+  explicit TCsrMatrix(const TMatExpr<E>& expr, const Alloc& a = Alloc())
+    : nr(check_size(expr.self().rows())), nc(check_size(expr.self().cols())), ptr(nr + 1), val(a)
+  {
+    const E& e = expr.self();
+    alignas(MEMORY_ALIGNMENT) T tmp[EXPR_CHUNK];
+    for (size_t i = 0; i < nr; i++)
+    {
+      for (size_t j = 0; j < nc; j += EXPR_CHUNK)
+      {
+        size_t k = std::min(EXPR_CHUNK, nc - j);
+        const T* src = mat_chunk(e, i, j, k, tmp);
+        for (size_t p = 0; p < k; p++)
+          if (src[p] != T())
+          {
+            col.push_back(uint32_t(j + p));
+            val.push_back(src[p]);
+          }
+      }
+      ptr[i + 1] = col.size();
+    }
+  }
+
+  size_t rows() const noexcept { return nr; }
+  size_t cols() const noexcept { return nc; }
+  size_t nonzeros() const noexcept { return col.size(); }
+  Alloc get_allocator() const { return val.get_allocator(); }
+
+  // массивы формата CSR
+  const size_t* row_ptr() const noexcept { return ptr.data(); }
+  const uint32_t* col_index() const noexcept { return col.data(); }
+  const T* values() const noexcept { return val.data(); }
+  // значения можно менять, структура (расположение ненулевых элементов) - нет
+  T* values() noexcept { return val.data(); }
+
+  // значение элемента: двоичный поиск в строке
+  T at(size_t i, size_t j) const
+  {
+    if (i >= nr || j >= nc)
+      throw out_of_range("Matrix index is out of range");
+    return (*this)(i, j);
+  }
+
+  // интерфейс матричного выражения
+  T operator()(size_t i, size_t j) const
+  {
+    const uint32_t* first = col.data() + ptr[i];
+    const uint32_t* last = col.data() + ptr[i + 1];
+    const uint32_t* p = std::lower_bound(first, last, uint32_t(j));
+    return p != last && *p == j ? val[p - col.data()] : T();
+  }
+  const T* row_data(size_t) const noexcept { return nullptr; }
+  void eval_row(size_t i, size_t j0, size_t n, T* out) const
+  {
+    std::fill(out, out + n, T());
+    const uint32_t* last = col.data() + ptr[i + 1];
+    const uint32_t* p = std::lower_bound(col.data() + ptr[i], last, uint32_t(j0));
+    for (; p != last && *p < j0 + n; ++p)
+      out[*p - j0] = val[p - col.data()];
+  }
+  template<typename M>
+  void eval_to(M& m) const { mat_assign(*this, m); }
+
+  // сравнение - по расположению и значениям хранимых элементов
+  bool operator==(const TCsrMatrix& m) const noexcept
+  {
+    return nr == m.nr && nc == m.nc && ptr == m.ptr && col == m.col && val == m.val;
+  }
+  bool operator!=(const TCsrMatrix& m) const noexcept
+  {
+    return !(*this == m);
+  }
+
+  TCsrMatrix& operator*=(const T& v)
+  {
+    if (!val.empty())
+      simd::mul_scalar(val.data(), v, val.data(), val.size());
+    return *this;
+  }
+
+  friend void swap(TCsrMatrix& lhs, TCsrMatrix& rhs) noexcept
+  {
+    std::swap(lhs.nr, rhs.nr);
+    std::swap(lhs.nc, rhs.nc);
+    lhs.ptr.swap(rhs.ptr);
+    lhs.col.swap(rhs.col);
+    lhs.val.swap(rhs.val);
+  }
+
+  friend TCsrMatrix operator+(const TCsrMatrix& a, const TCsrMatrix& b)
+  {
+    return merge<TExprAdd>(a, b);
+  }
+  friend TCsrMatrix operator-(const TCsrMatrix& a, const TCsrMatrix& b)
+  {
+    return merge<TExprSub>(a, b);
+  }
+  friend TCsrMatrix operator*(const TCsrMatrix& a, const TCsrMatrix& b)
+  {
+    return multiply(a, b);
+  }
+
+  // транспонирование подсчетом: O(nnz + r + c), столбцы в строках
+  // результата получаются упорядоченными
+  friend TCsrMatrix transpose(const TCsrMatrix& a)
+  {
+    TCsrMatrix t(a.nc, a.nr, a.get_allocator());
+    t.col.resize(a.nonzeros());
+    t.val.resize(a.nonzeros());
+    for (size_t k = 0; k < a.nonzeros(); k++)
+      t.ptr[a.col[k] + 1]++;
+    for (size_t j = 0; j < a.nc; j++)
+      t.ptr[j + 1] += t.ptr[j];
+    std::vector<size_t> next(t.ptr.begin(), t.ptr.end() - 1);
+    for (size_t i = 0; i < a.nr; i++)
+      for (size_t k = a.ptr[i]; k < a.ptr[i + 1]; k++)
+      {
+        size_t d = next[a.col[k]]++;
+        t.col[d] = uint32_t(i);
+        t.val[d] = a.val[k];
+      }
+    return t;
+  }
+};
+
+template<typename T, typename A>
+TCsrMatrix<T, A> operator*(TCsrMatrix<T, A> a, typename TCsrMatrix<T, A>::value_type val)
+{
+  a *= val;
+  return a;
+}
+template<typename T, typename A>
+TCsrMatrix<T, A> operator*(typename TCsrMatrix<T, A>::value_type val, TCsrMatrix<T, A> a)
+{
+  a *= val;
+  return a;
+}
+
+namespace sparse_detail
+{
+  // y(i) = сумма a(i, j) * x(j) по ненулевым элементам строк [i0, i1)
+  template<typename T>
+  void spmv(const size_t* ptr, const uint32_t* col, const T* val, const T* x, T* y, size_t i0, size_t i1)
+  {
+    for (size_t i = i0; i < i1; i++)
+    {
+      T s = T();
+      for (size_t k = ptr[i]; k < ptr[i + 1]; k++)
+        s += val[k] * x[col[k]];
+      y[i] = s;
+    }
+  }
+}
+
+// Умножение на вектор. Для больших матриц строки делятся между потоками
+// на части с примерно равным числом ненулевых элементов
+template<typename T, typename A, typename V>
+TDynamicVector<T, A> operator*(const TCsrMatrix<T, A>& a, const TVecExpr<V>& b)
+{
+  const V& x = b.self();
+  if (a.cols() != x.size())
+    throw length_error("Vector size should be equal to matrix column count");
+  std::unique_ptr<TDynamicVector<T>> tmp;
+  const T* px = x.data();
+  if (px == nullptr)
+  {
+    tmp.reset(new TDynamicVector<T>(x));
+    px = tmp->data();
+  }
+  TDynamicVector<T, A> res(a.rows(), uninitialized, a.get_allocator());
+  const size_t* ptr = a.row_ptr();
+  size_t n = a.rows(), nnz = a.nonzeros();
+  if (thread_pool().size() == 1 || nnz < SPARSE_PARALLEL_THRESHOLD)
+  {
+    sparse_detail::spmv(ptr, a.col_index(), a.values(), px, res.data(), 0, n);
+    return res;
+  }
+  size_t parts = thread_pool().size() * 4;
+  // первая строка части p - та, на которую приходится ее доля ненулевых элементов
+  std::vector<size_t> bounds(parts + 1, n);
+  for (size_t p = 0; p < parts; p++)
+    bounds[p] = std::lower_bound(ptr, ptr + n, nnz / parts * p) - ptr;
+  thread_pool().parallel_for(parts, [&](size_t p)
+  {
+    sparse_detail::spmv(ptr, a.col_index(), a.values(), px, res.data(), bounds[p], bounds[p + 1]);
+  });
+  return res;
+}
+
+// Число строк в порции SELL: порция обрабатывается векторными командами целиком
+const size_t SELL_CHUNK = 8;
+// Окно сортировки строк по длине (sigma) по умолчанию
+const size_t SELL_SIGMA = 256;
+
+namespace sell_detail
+{
+  // acc(r) = сумма val[k * C + r] * x[col[k * C + r]] по k из [0, rlen[r]);
+  // первый параметр - длина порции, дополнение за пределами rlen[r] не читается
+  template<typename T>
+  void chunk_kernel(size_t, const uint32_t* rlen, const T* val, const uint32_t* col, const T* x, T* acc)
+  {
+    const size_t C = SELL_CHUNK;
+    for (size_t r = 0; r < C; r++)
+    {
+      T s = T();
+      for (size_t k = 0; k < rlen[r]; k++)
+        s += val[k * C + r] * x[col[k * C + r]];
+      acc[r] = s;
+    }
+  }
+  typedef void (*TChunkKernel64)(size_t, const uint32_t*, const double*, const uint32_t*, const double*, double*);
+  typedef void (*TChunkKernel32)(size_t, const uint32_t*, const float*, const uint32_t*, const float*, float*);
+}
+
+#ifdef TMATRIX_SIMD_X86
+
+// Ядра порции SELL с явной сборкой (gather) элементов x. Дорожки строк,
+// у которых k >= rlen[r], маскируются: x для них не читается, а сумма
+// не меняется, поэтому бесконечности и NaN в x не попадают в чужие строки
+TMATRIX_TARGET_PUSH_AVX2
+namespace sell_avx2
+{
+  inline void chunk_kernel(size_t len, const uint32_t* rlen, const double* val, const uint32_t* col,
+    const double* x, double* acc)
+  {
+    __m256d s0 = _mm256_setzero_pd(), s1 = s0, zero = s0;
+    __m256i lens = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rlen));
+    for (size_t k = 0; k < len; k++, val += 8, col += 8)
+    {
+      __m256i m = _mm256_cmpgt_epi32(lens, _mm256_set1_epi32(int(k)));
+      __m256d m0 = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(m)));
+      __m256d m1 = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm256_extracti128_si256(m, 1)));
+      __m128i j0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(col));
+      __m128i j1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(col + 4));
+      __m256d x0 = _mm256_mask_i32gather_pd(zero, x, j0, m0, 8);
+      __m256d x1 = _mm256_mask_i32gather_pd(zero, x, j1, m1, 8);
+      s0 = _mm256_blendv_pd(s0, _mm256_fmadd_pd(_mm256_loadu_pd(val), x0, s0), m0);
+      s1 = _mm256_blendv_pd(s1, _mm256_fmadd_pd(_mm256_loadu_pd(val + 4), x1, s1), m1);
+    }
+    _mm256_storeu_pd(acc, s0);
+    _mm256_storeu_pd(acc + 4, s1);
+  }
+  inline void chunk_kernel(size_t len, const uint32_t* rlen, const float* val, const uint32_t* col,
+    const float* x, float* acc)
+  {
+    __m256 s = _mm256_setzero_ps(), zero = s;
+    __m256i lens = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rlen));
+    for (size_t k = 0; k < len; k++, val += 8, col += 8)
+    {
+      __m256 m = _mm256_castsi256_ps(_mm256_cmpgt_epi32(lens, _mm256_set1_epi32(int(k))));
+      __m256i j = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col));
+      __m256 xj = _mm256_mask_i32gather_ps(zero, x, j, m, 4);
+      s = _mm256_blendv_ps(s, _mm256_fmadd_ps(_mm256_loadu_ps(val), xj, s), m);
+    }
+    _mm256_storeu_ps(acc, s);
+  }
+}
+TMATRIX_TARGET_POP
+
+TMATRIX_TARGET_PUSH_AVX512
+namespace sell_avx512
+{
+  inline void chunk_kernel(size_t len, const uint32_t* rlen, const double* val, const uint32_t* col,
+    const double* x, double* acc)
+  {
+    __m512d s = _mm512_setzero_pd(), zero = s;
+    __m512i lens = _mm512_cvtepu32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rlen)));
+    for (size_t k = 0; k < len; k++, val += 8, col += 8)
+    {
+      __mmask8 m = _mm512_cmpgt_epi64_mask(lens, _mm512_set1_epi64((long long)k));
+      __m256i j = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col));
+      __m512d xj = _mm512_mask_i32gather_pd(zero, m, j, x, 8);
+      s = _mm512_mask3_fmadd_pd(_mm512_loadu_pd(val), xj, s, m);
+    }
+    _mm512_storeu_pd(acc, s);
+  }
+}
+TMATRIX_TARGET_POP
+
+#endif // TMATRIX_SIMD_X86
+
+namespace sell_detail
+{
+  // Выбор ядра порции по текущему набору инструкций
+  template<typename T>
+  void (*select_chunk_kernel())(size_t, const uint32_t*, const T*, const uint32_t*, const T*, T*)
+  {
+    return &chunk_kernel<T>;
+  }
+#ifdef TMATRIX_SIMD_X86
+  template<>
+  inline TChunkKernel64 select_chunk_kernel<double>()
+  {
+    switch (simd_level())
+    {
+    case SIMD_AVX512: return &sell_avx512::chunk_kernel;
+    case SIMD_AVX2: return &sell_avx2::chunk_kernel;
+    default: return &chunk_kernel<double>;
+    }
+  }
+  template<>
+  inline TChunkKernel32 select_chunk_kernel<float>()
+  {
+    switch (simd_level())
+    {
+    case SIMD_AVX512:
+    case SIMD_AVX2: return &sell_avx2::chunk_kernel;
+    default: return &chunk_kernel<float>;
+    }
+  }
+#endif
+}
+
+// Разреженная матрица в формате SELL-C-sigma.
+// Строки сортируются по убыванию числа ненулевых элементов внутри окон
+// из sigma строк и группируются в порции по C = SELL_CHUNK строк.
+// Порция дополняется нулями до длины самой длинной строки и хранится
+// по столбцам: k-е элементы всех C строк лежат подряд, поэтому умножение
+// на вектор обрабатывает C строк одной векторной командой независимо от
+// разброса длин строк. Сортировка уменьшает дополнение нулями.
+// Длины строк хранятся для каждой порции, и ядра пропускают дополнение,
+// а не умножают его на x, иначе 0 * Inf = NaN испортил бы результат строки
+template<typename T, typename Alloc = TAlignedAllocator<T>>
+class TSellMatrix
+{
+  size_t nr, nc;
+  std::vector<size_t> cptr;     // начало порции c в col и val
+  std::vector<uint32_t> perm;   // perm[s] - исходный номер s-й строки после сортировки
+  std::vector<uint32_t> rlen;   // rlen[s] - длина s-й строки после сортировки, C на порцию
+  std::vector<uint32_t> col;    // у дополнения - столбец 0
+  std::vector<T, Alloc> val;
+public:
+  typedef T value_type;
+  typedef Alloc allocator_type;
+
+  explicit TSellMatrix(const TCsrMatrix<T, Alloc>& a, size_t sigma = SELL_SIGMA)
+    : nr(a.rows()), nc(a.cols()), cptr((a.rows() + SELL_CHUNK - 1) / SELL_CHUNK + 1), perm(a.rows()),
+      rlen((cptr.size() - 1) * SELL_CHUNK, 0), val(a.get_allocator())
+  {
+    const size_t C = SELL_CHUNK;
+    if (sigma == 0)
+      throw out_of_range("Sorting window should be greater than zero");
+    const size_t* ptr = a.row_ptr();
+    auto length = [ptr](uint32_t i) { return ptr[i + 1] - ptr[i]; };
+    for (size_t s = 0; s < nr; s++)
+      perm[s] = uint32_t(s);
+    for (size_t w = 0; w < nr; w += sigma)
+      std::stable_sort(perm.begin() + w, perm.begin() + std::min(nr, w + sigma),
+        [&length](uint32_t i, uint32_t j) { return length(i) > length(j); });
+
+    size_t nch = cptr.size() - 1;
+    for (size_t c = 0; c < nch; c++)
+    {
+      size_t len = 0;
+      for (size_t s = c * C; s < std::min(nr, c * C + C); s++)
+        len = std::max(len, length(perm[s]));
+      cptr[c + 1] = cptr[c] + len * C;
+    }
+    col.assign(cptr[nch], 0);
+    val.assign(cptr[nch], T());
+    for (size_t s = 0; s < nr; s++)
+    {
+      size_t base = cptr[s / C] + s % C, i = perm[s];
+      rlen[s] = uint32_t(length(perm[s]));
+      for (size_t k = 0; k < rlen[s]; k++)
+      {
+        col[base + k * C] = a.col_index()[ptr[i] + k];
+        val[base + k * C] = a.values()[ptr[i] + k];
+      }
+    }
+  }
+
+  size_t rows() const noexcept { return nr; }
+  size_t cols() const noexcept { return nc; }
+  // число хранимых элементов вместе с дополнением нулями
+  size_t stored() const noexcept { return val.size(); }
+  Alloc get_allocator() const { return val.get_allocator(); }
+
+  // массивы формата
+  size_t chunks() const noexcept { return cptr.size() - 1; }
+  const size_t* chunk_ptr() const noexcept { return cptr.data(); }
+  const uint32_t* row_perm() const noexcept { return perm.data(); }
+  const uint32_t* row_length() const noexcept { return rlen.data(); }
+  const uint32_t* col_index() const noexcept { return col.data(); }
+  const T* values() const noexcept { return val.data(); }
+};
+
+// Умножение на вектор: порции делятся между потоками на части
+// с примерно равным числом хранимых элементов
+template<typename T, typename A, typename V>
+TDynamicVector<T, A> operator*(const TSellMatrix<T, A>& a, const TVecExpr<V>& b)
+{
+  const size_t C = SELL_CHUNK;
+  const V& x = b.self();
+  if (a.cols() != x.size())
+    throw length_error("Vector size should be equal to matrix column count");
+  std::unique_ptr<TDynamicVector<T>> tmp;
+  const T* px = x.data();
+  if (px == nullptr)
+  {
+    tmp.reset(new TDynamicVector<T>(x));
+    px = tmp->data();
+  }
+  TDynamicVector<T, A> res(a.rows(), uninitialized, a.get_allocator());
+  T* y = res.data();
+  const size_t* cptr = a.chunk_ptr();
+  const uint32_t* perm = a.row_perm();
+  size_t n = a.rows(), nch = a.chunks();
+  auto kernel = sell_detail::select_chunk_kernel<T>();
+  auto run = [&](size_t c0, size_t c1)
+  {
+    alignas(MEMORY_ALIGNMENT) T acc[SELL_CHUNK];
+    for (size_t c = c0; c < c1; c++)
+    {
+      kernel((cptr[c + 1] - cptr[c]) / C, a.row_length() + c * C, a.values() + cptr[c], a.col_index() + cptr[c],
+        px, acc);
+      for (size_t r = 0, s = c * C; r < C && s < n; r++, s++)
+        y[perm[s]] = acc[r];
+    }
+  };
+  if (thread_pool().size() == 1 || a.stored() < SPARSE_PARALLEL_THRESHOLD)
+  {
+    run(0, nch);
+    return res;
+  }
+  size_t parts = thread_pool().size() * 4;
+  std::vector<size_t> bounds(parts + 1, nch);
+  for (size_t p = 0; p < parts; p++)
+    bounds[p] = std::lower_bound(cptr, cptr + nch, a.stored() / parts * p) - cptr;
+  thread_pool().parallel_for(parts, [&](size_t p) { run(bounds[p], bounds[p + 1]); });
+  return res;
+}
+
+namespace bsr_detail
+{
+  // y += blk * x для плотного блока B x B, хранимого по строкам;
+  // размер известен при компиляции, циклы разворачиваются полностью
+  template<size_t B, typename T>
+  inline void block_gemv(const T* blk, const T* x, T* y)
+  {
+    for (size_t r = 0; r < B; r++)
+    {
+      T s = T();
+      for (size_t c = 0; c < B; c++)
+        s += blk[r * B + c] * x[c];
+      y[r] += s;
+    }
+  }
+}
+
+// Блочная разреженная матрица (BSR): ненулевые элементы сгруппированы
+// в плотные блоки B x B. Блоки блочной строки bi лежат в bcol[bptr[bi]..bptr[bi + 1])
+// (номера блочных столбцов по возрастанию), значения блока k - в val[k * B * B..]
+// по строкам. Один номер столбца приходится на B * B элементов, а умножение
+// блока на вектор выполняется ядром фиксированного размера с x и y в регистрах.
+// Размеры матрицы должны быть кратны B
+template<typename T, size_t B, typename Alloc = TAlignedAllocator<T>>
+class TBsrMatrix : public TMatExpr<TBsrMatrix<T, B, Alloc>>
+{
+  static_assert(B > 0, "Block size should be greater than zero");
+
+  size_t nr, nc;
+  std::vector<size_t> bptr;
+  std::vector<uint32_t> bcol;
+  std::vector<T, Alloc> val;
+
+  // номер блока (bi, bj) или nonzero_blocks(), если блок не хранится
+  size_t find(size_t bi, size_t bj) const
+  {
+    const uint32_t* first = bcol.data() + bptr[bi];
+    const uint32_t* last = bcol.data() + bptr[bi + 1];
+    const uint32_t* p = std::lower_bound(first, last, uint32_t(bj));
+    return p != last && *p == bj ? p - bcol.data() : bcol.size();
+  }
+public:
+  typedef T value_type;
+  typedef TDynamicMatrix<T> matrix_type;
+  typedef Alloc allocator_type;
+
+  // блоки, содержащие хотя бы один хранимый элемент CSR-матрицы;
+  // остальные элементы таких блоков равны нулю
+  explicit TBsrMatrix(const TCsrMatrix<T, Alloc>& a)
+    : nr(a.rows()), nc(a.cols()), bptr(a.rows() / B + 1), val(a.get_allocator())
+  {
+    if (nr % B != 0 || nc % B != 0)
+      throw length_error("Matrix size should be a multiple of block size");
+    const size_t* ptr = a.row_ptr();
+    const uint32_t* col = a.col_index();
+    size_t nbr = nr / B;
+    // mark[bj] - номер блока (bi, bj) плюс один, если он уже есть в блочной строке bi
+    std::vector<size_t> mark(nc / B, 0);
+    for (size_t bi = 0; bi < nbr; bi++)
+    {
+      size_t first = bcol.size();
+      for (size_t p = ptr[bi * B]; p < ptr[bi * B + B]; p++)
+        if (mark[col[p] / B] <= first)
+        {
+          bcol.push_back(uint32_t(col[p] / B));
+          mark[col[p] / B] = bcol.size();
+        }
+      std::sort(bcol.begin() + first, bcol.end());
+      bptr[bi + 1] = bcol.size();
+    }
+    val.assign(bcol.size() * B * B, T());
+    for (size_t bi = 0; bi < nbr; bi++)
+      for (size_t r = 0; r < B; r++)
+      {
+        size_t i = bi * B + r, k = bptr[bi];
+        // столбцы строки и блоки строки идут по возрастанию
+        for (size_t p = ptr[i]; p < ptr[i + 1]; p++)
+        {
+          while (bcol[k] != col[p] / B)
+            k++;
+          val[k * B * B + r * B + col[p] % B] = a.values()[p];
+        }
+      }
+  }
+
+  size_t rows() const noexcept { return nr; }
+  size_t cols() const noexcept { return nc; }
+  size_t nonzero_blocks() const noexcept { return bcol.size(); }
+  Alloc get_allocator() const { return val.get_allocator(); }
+
+  // массивы формата
+  const size_t* block_ptr() const noexcept { return bptr.data(); }
+  const uint32_t* block_col() const noexcept { return bcol.data(); }
+  const T* values() const noexcept { return val.data(); }
+  T* values() noexcept { return val.data(); }
+
+  T at(size_t i, size_t j) const
+  {
+    if (i >= nr || j >= nc)
+      throw out_of_range("Matrix index is out of range");
+    return (*this)(i, j);
+  }
+
+  // интерфейс матричного выражения
+  T operator()(size_t i, size_t j) const
+  {
+    size_t k = find(i / B, j / B);
+    return k != bcol.size() ? val[k * B * B + i % B * B + j % B] : T();
+  }
+  const T* row_data(size_t) const noexcept { return nullptr; }
+  void eval_row(size_t i, size_t j0, size_t n, T* out) const
+  {
+    std::fill(out, out + n, T());
+    size_t bi = i / B, r = i % B;
+    for (size_t k = bptr[bi]; k < bptr[bi + 1]; k++)
+    {
+      size_t c0 = size_t(bcol[k]) * B;
+      if (c0 + B <= j0 || c0 >= j0 + n)
+        continue;
+      for (size_t c = std::max(c0, j0); c < std::min(c0 + B, j0 + n); c++)
+        out[c - j0] = val[k * B * B + r * B + c - c0];
+    }
+  }
+  template<typename M>
+  void eval_to(M& m) const { mat_assign(*this, m); }
+
+  TBsrMatrix& operator*=(const T& v)
+  {
+    if (!val.empty())
+      simd::mul_scalar(val.data(), v, val.data(), val.size());
+    return *this;
+  }
+};
+
+// Умножение на вектор: блочные строки делятся между потоками
+// на части с примерно равным числом блоков
+template<typename T, size_t B, typename A, typename V>
+TDynamicVector<T, A> operator*(const TBsrMatrix<T, B, A>& a, const TVecExpr<V>& b)
+{
+  const V& x = b.self();
+  if (a.cols() != x.size())
+    throw length_error("Vector size should be equal to matrix column count");
+  std::unique_ptr<TDynamicVector<T>> tmp;
+  const T* px = x.data();
+  if (px == nullptr)
+  {
+    tmp.reset(new TDynamicVector<T>(x));
+    px = tmp->data();
+  }
+  TDynamicVector<T, A> res(a.rows(), uninitialized, a.get_allocator());
+  T* y = res.data();
+  const size_t* bptr = a.block_ptr();
+  const uint32_t* bcol = a.block_col();
+  const T* val = a.values();
+  size_t nbr = a.rows() / B, nb = a.nonzero_blocks();
+  auto run = [&](size_t b0, size_t b1)
+  {
+    for (size_t bi = b0; bi < b1; bi++)
+    {
+      T acc[B] = {};
+      for (size_t k = bptr[bi]; k < bptr[bi + 1]; k++)
+        bsr_detail::block_gemv<B>(val + k * B * B, px + size_t(bcol[k]) * B, acc);
+      std::copy(acc, acc + B, y + bi * B);
+    }
+  };
+  if (thread_pool().size() == 1 || nb * B * B < SPARSE_PARALLEL_THRESHOLD)
+  {
+    run(0, nbr);
+    return res;
+  }
+  size_t parts = thread_pool().size() * 4;
+  std::vector<size_t> bounds(parts + 1, nbr);
+  for (size_t p = 0; p < parts; p++)
+    bounds[p] = std::lower_bound(bptr, bptr + nbr, nb / parts * p) - bptr;
+  thread_pool().parallel_for(parts, [&](size_t p) { run(bounds[p], bounds[p + 1]); });
+  return res;
+}
+
+#endif
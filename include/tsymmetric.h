@@ -0,0 +1,248 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Симметричная матрица в упакованном виде
+
+#ifndef __TSymmetric_H__
+#define __TSymmetric_H__
+
+#include <vector>
+#include <utility>
+#include "ttriangular.h"
+
+// Симметричная матрица n x n -
+// хранится верхняя половина (j >= i) в том же виде, что у TUpperTriangularMatrix.
+// Элемент (i, j) при j < i берется из (j, i). Сложение, вычитание,
+// умножение на скаляр и вектор обрабатывают только хранимую половину
+template<typename T, typename Alloc = TAlignedAllocator<T>>
+class TSymmetricMatrix : public TMatExpr<TSymmetricMatrix<T, Alloc>>
+{
+  TUpperTriangularMatrix<T, Alloc> u;
+public:
+  typedef T value_type;
+  typedef TDynamicMatrix<T> matrix_type;
+  typedef Alloc allocator_type;
+
+  TSymmetricMatrix(size_t s = 1, const Alloc& a = Alloc()) : u(s, a) {}
+  // элементы не инициализируются
+  TSymmetricMatrix(size_t s, TUninitialized, const Alloc& a = Alloc()) : u(s, uninitialized, a) {}
+  // верхняя половина квадратного выражения, нижняя считается ей симметричной
+  template<typename E>
+  explicit TSymmetricMatrix(const TMatExpr<E>& expr, const Alloc& a = Alloc()) : u(expr, a) {}
+
+  size_t size() const noexcept { return u.size(); }
+  size_t rows() const noexcept { return u.size(); }
+  size_t cols() const noexcept { return u.size(); }
+  Alloc get_allocator() const { return u.get_allocator(); }
+
+  // m[i][j] - элемент, только для j >= i
+  T* operator[](size_t i) { return u[i]; }
+  const T* operator[](size_t i) const { return u[i]; }
+
+  // индексация с контролем; (i, j) и (j, i) - один и тот же элемент
+  T& at(size_t i, size_t j)
+  {
+    if (i >= size() || j >= size())
+      throw out_of_range("Matrix index is out of range");
+    return j < i ? u[j][i] : u[i][j];
+  }
+  const T& at(size_t i, size_t j) const
+  {
+    if (i >= size() || j >= size())
+      throw out_of_range("Matrix index is out of range");
+    return j < i ? u[j][i] : u[i][j];
+  }
+
+  // интерфейс матричного выражения
+  T operator()(size_t i, size_t j) const { return j < i ? u[j][i] : u[i][j]; }
+  const T* row_data(size_t) const noexcept { return nullptr; }
+  // часть строки левее диагонали - столбец хранимой половины
+  void eval_row(size_t i, size_t j0, size_t n, T* out) const
+  {
+    size_t z = i > j0 ? std::min(i - j0, n) : 0;
+    for (size_t j = 0; j < z; j++)
+      out[j] = u[j0 + j][i];
+    std::copy(u[i] + j0 + z, u[i] + j0 + n, out + z);
+  }
+  template<typename M>
+  void eval_to(M& m) const { mat_assign(*this, m); }
+
+  // сравнение
+  bool operator==(const TSymmetricMatrix& m) const noexcept { return u == m.u; }
+  bool operator!=(const TSymmetricMatrix& m) const noexcept { return u != m.u; }
+
+  // обновление на месте - по хранимой половине
+  TSymmetricMatrix& operator+=(const TSymmetricMatrix& m)
+  {
+    u += m.u;
+    return *this;
+  }
+  TSymmetricMatrix& operator-=(const TSymmetricMatrix& m)
+  {
+    u -= m.u;
+    return *this;
+  }
+  TSymmetricMatrix& operator*=(const T& val)
+  {
+    u *= val;
+    return *this;
+  }
+
+  friend void swap(TSymmetricMatrix& lhs, TSymmetricMatrix& rhs) noexcept
+  {
+    swap(lhs.u, rhs.u);
+  }
+
+  // ввод - только элементы j >= i по строкам, вывод - вся матрица
+  friend istream& operator>>(istream& istr, TSymmetricMatrix& v)
+  {
+    return istr >> v.u;
+  }
+  friend ostream& operator<<(ostream& ostr, const TSymmetricMatrix& v)
+  {
+    for (size_t i = 0; i < v.size(); i++)
+    {
+      for (size_t j = 0; j < v.size(); j++)
+        ostr << v(i, j) << ' ';
+      ostr << endl;
+    }
+    return ostr;
+  }
+};
+
+template<typename T, typename A>
+TSymmetricMatrix<T, A> operator+(TSymmetricMatrix<T, A> a, const TSymmetricMatrix<T, A>& b)
+{
+  a += b;
+  return a;
+}
+template<typename T, typename A>
+TSymmetricMatrix<T, A> operator-(TSymmetricMatrix<T, A> a, const TSymmetricMatrix<T, A>& b)
+{
+  a -= b;
+  return a;
+}
+template<typename T, typename A>
+TSymmetricMatrix<T, A> operator*(TSymmetricMatrix<T, A> a, typename TSymmetricMatrix<T, A>::value_type val)
+{
+  a *= val;
+  return a;
+}
+template<typename T, typename A>
+TSymmetricMatrix<T, A> operator*(typename TSymmetricMatrix<T, A>::value_type val, TSymmetricMatrix<T, A> a)
+{
+  a *= val;
+  return a;
+}
+
+// Умножение на вектор: каждый хранимый элемент читается один раз и
+// используется дважды - в скалярном произведении для y(i) и в обновлении y(j), j > i,
+// оба выполняет одно ядро dot_axpy
+template<typename T, typename A, typename V>
+TDynamicVector<T, A> operator*(const TSymmetricMatrix<T, A>& a, const TVecExpr<V>& b)
+{
+  const V& x = b.self();
+  size_t n = a.size();
+  if (n != x.size())
+    throw length_error("Vector size should be equal to matrix column count");
+  std::unique_ptr<TDynamicVector<T>> tmp;
+  const T* px = x.data();
+  if (px == nullptr)
+  {
+    tmp.reset(new TDynamicVector<T>(x));
+    px = tmp->data();
+  }
+  TDynamicVector<T, A> res(n, a.get_allocator());
+  T* y = res.data();
+  for (size_t i = 0; i < n; i++)
+  {
+    const T* ai = a[i];
+    y[i] += ai[i] * px[i] + simd::dot_axpy(px[i], ai + i + 1, px + i + 1, y + i + 1, n - i - 1);
+  }
+  return res;
+}
+
+namespace symmetric_detail
+{
+  // c(i, j) = alpha * a(i) . a(j) + beta * c(i, j) для j >= i;
+  // a(i) - указатель на строку i матрицы A из k элементов
+  template<typename T, typename Row, typename M>
+  void syrk(size_t n, size_t k, T alpha, Row a, T beta, M& c, std::false_type)
+  {
+    for (size_t i = 0; i < n; i++)
+    {
+      T* ci = c[i];
+      for (size_t j = i; j < n; j++)
+      {
+        T s = alpha * simd::dot(a(i), a(j), k);
+        ci[j] = beta == T() ? s : s + beta * ci[j];
+      }
+    }
+  }
+
+  // По плиткам C(I, J), J >= I, как произведение треугольных матриц:
+  // плитка - gemm строк A из блока I на транспонированные строки A из блока J.
+  // Диагональные плитки считаются в плотном буфере, из которого
+  // переносится верхняя половина
+  template<typename T, typename Row, typename M>
+  void syrk(size_t n, size_t k, T alpha, Row a, T beta, M& c, std::true_type)
+  {
+    const size_t BS = TRIANGULAR_BLOCK;
+    if (n < 2 * BS || k < GEMM_BLOCKED_THRESHOLD)
+    {
+      syrk(n, k, alpha, a, beta, c, std::false_type());
+      return;
+    }
+    size_t nb = (n + BS - 1) / BS;
+    std::vector<std::pair<size_t, size_t>> tiles;
+    for (size_t ib = 0; ib < nb; ib++)
+      for (size_t jb = ib; jb < nb; jb++)
+        tiles.push_back(std::make_pair(ib, jb));
+
+    thread_pool().parallel_for(tiles.size(), [&](size_t t)
+    {
+      size_t ib = tiles[t].first, jb = tiles[t].second;
+      size_t i0 = ib * BS, mi = std::min(BS, n - i0);
+      size_t j0 = jb * BS, mj = std::min(BS, n - j0);
+      std::vector<T, TAlignedAllocator<T>> cd(ib == jb ? mi * mi : 0);
+      if (ib == jb && beta != T())
+        for (size_t i = 0; i < mi; i++)
+          std::copy(c[i0 + i] + i0 + i, c[i0 + i] + i0 + mi, cd.data() + i * mi + i);
+      gemm(mi, mj, k, alpha,
+        [&](size_t i) { return a(i0 + i); },
+        gemm_transposed([&](size_t j) { return a(j0 + j); }),
+        beta,
+        [&](size_t i) { return ib == jb ? cd.data() + i * mi : c[i0 + i] + j0; });
+      if (ib == jb)
+        for (size_t i = 0; i < mi; i++)
+          std::copy(cd.data() + i * mi + i, cd.data() + i * mi + mi, c[i0 + i] + i0 + i);
+    });
+  }
+}
+
+// C = alpha * A * A^T + beta * C - симметричное обновление ранга k (A - n x k).
+// Вычисляется только верхняя половина C: вдвое меньше умножений, чем у A * A^T
+template<typename T, typename Alloc, typename E>
+void syrk(typename TSymmetricMatrix<T, Alloc>::value_type alpha, const TMatExpr<E>& a,
+          typename TSymmetricMatrix<T, Alloc>::value_type beta, TSymmetricMatrix<T, Alloc>& c)
+{
+  TMatValue<E> av(a.self());
+  const typename TMatValue<E>::type& m = av.get();
+  if (m.rows() != c.size())
+    throw length_error("Matrix row count should be equal to result size");
+  symmetric_detail::syrk(c.size(), m.cols(), alpha, [&m](size_t i) { return m.row_data(i); },
+    beta, c, std::is_arithmetic<T>());
+}
+
+// Матрица Грама A * A^T
+template<typename E>
+TSymmetricMatrix<typename E::value_type> syrk(const TMatExpr<E>& a)
+{
+  typedef typename E::value_type T;
+  TSymmetricMatrix<T> c(a.self().rows(), uninitialized);
+  syrk(T(1), a, T(), c);
+  return c;
+}
+
+#endif
@@ -0,0 +1,222 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Пул потоков для параллельных ядер
+
+#ifndef __TThreadPool_H__
+#define __TThreadPool_H__
+
+#include <cstddef>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <functional>
+
+// Пул потоков -
+// потоки создаются один раз и переиспользуются между вызовами parallel_for
+class TThreadPool
+{
+  std::vector<std::thread> workers;
+  std::mutex mtx;
+  std::condition_variable cvStart, cvDone;
+  std::mutex callMtx;                 // один parallel_for или resize за раз
+  std::atomic<size_t> nthreads;       // число потоков, меняется под callMtx
+
+  // текущее задание
+  const std::function<void(size_t)>* job;
+  size_t jobCount;
+  std::atomic<size_t> nextIndex;
+  size_t busy;                        // рабочих, еще не закончивших задание
+  size_t generation;
+  bool stop;
+  std::exception_ptr error;           // первое исключение из итераций задания
+
+  static bool& inside_worker()
+  {
+    static thread_local bool flag = false;
+    return flag;
+  }
+  // признак "внутри задания" на время жизни объекта,
+  // восстанавливается и при выходе по исключению
+  class TInsideGuard
+  {
+    bool old;
+  public:
+    TInsideGuard() : old(inside_worker()) { inside_worker() = true; }
+    ~TInsideGuard() { inside_worker() = old; }
+    TInsideGuard(const TInsideGuard&) = delete;
+    TInsideGuard& operator=(const TInsideGuard&) = delete;
+  };
+
+  // исключение итерации запоминается, оставшиеся итерации пропускаются
+  void run_job()
+  {
+    size_t i;
+    while ((i = nextIndex.fetch_add(1)) < jobCount)
+    {
+      try
+      {
+        (*job)(i);
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!error)
+          error = std::current_exception();
+        nextIndex = jobCount;
+      }
+    }
+  }
+
+  void worker_loop()
+  {
+    inside_worker() = true;
+    size_t seen = 0;
+    for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cvStart.wait(lock, [&] { return stop || generation != seen; });
+        if (stop)
+          return;
+        seen = generation;
+      }
+      run_job();
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--busy == 0)
+          cvDone.notify_one();
+      }
+    }
+  }
+
+  void start(size_t threads)
+  {
+    stop = false;
+    // вызывающий поток тоже выполняет работу, поэтому рабочих на один меньше
+    for (size_t i = 1; i < threads; i++)
+      workers.emplace_back(&TThreadPool::worker_loop, this);
+    nthreads = threads;
+  }
+  void shutdown()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stop = true;
+    }
+    cvStart.notify_all();
+    for (size_t i = 0; i < workers.size(); i++)
+      workers[i].join();
+    workers.clear();
+    nthreads = 1;
+  }
+public:
+  explicit TThreadPool(size_t threads = 1)
+    : nthreads(1), job(nullptr), jobCount(0), nextIndex(0), busy(0), generation(0), stop(false)
+  {
+    start(threads == 0 ? 1 : threads);
+  }
+  ~TThreadPool()
+  {
+    shutdown();
+  }
+  TThreadPool(const TThreadPool&) = delete;
+  TThreadPool& operator=(const TThreadPool&) = delete;
+
+  size_t size() const noexcept { return nthreads; }
+
+  // изменение числа потоков; потоки пересоздаются
+  void resize(size_t threads)
+  {
+    std::lock_guard<std::mutex> call(callMtx);
+    if (threads == 0)
+      threads = 1;
+    if (threads == size())
+      return;
+    shutdown();
+    start(threads);
+  }
+
+  // f(i) для i из [0, count); возврат после завершения всех итераций.
+  // Вызов из рабочего потока пула выполняется последовательно.
+  // Если итерация бросила исключение, оставшиеся итерации пропускаются,
+  // и после остановки всех потоков первое исключение передается вызывающему
+  void parallel_for(size_t count, const std::function<void(size_t)>& f)
+  {
+    if (count == 0)
+      return;
+    if (count == 1 || nthreads == 1 || inside_worker())
+    {
+      for (size_t i = 0; i < count; i++)
+        f(i);
+      return;
+    }
+    std::lock_guard<std::mutex> call(callMtx);
+    TInsideGuard inside;
+    // пул мог уменьшиться до одного потока, пока ждали callMtx
+    if (workers.empty())
+    {
+      for (size_t i = 0; i < count; i++)
+        f(i);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      job = &f;
+      jobCount = count;
+      nextIndex = 0;
+      busy = workers.size();
+      error = nullptr;
+      generation++;
+    }
+    cvStart.notify_all();
+    run_job();
+    std::exception_ptr e;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cvDone.wait(lock, [&] { return busy == 0; });
+      job = nullptr;
+      std::swap(e, error);
+    }
+    if (e)
+      std::rethrow_exception(e);
+  }
+};
+
+// Число потоков по умолчанию:
+// переменная окружения TMATRIX_NUM_THREADS, иначе число ядер
+inline size_t default_num_threads()
+{
+  const char* env = std::getenv("TMATRIX_NUM_THREADS");
+  if (env != nullptr)
+  {
+    long n = std::strtol(env, nullptr, 10);
+    if (n > 0)
+      return size_t(n);
+  }
+  size_t hw = std::thread::hardware_concurrency();
+  return hw == 0 ? 1 : hw;
+}
+
+// Общий пул библиотеки
+inline TThreadPool& thread_pool()
+{
+  static TThreadPool pool(default_num_threads());
+  return pool;
+}
+
+inline size_t get_num_threads()
+{
+  return thread_pool().size();
+}
+inline void set_num_threads(size_t threads)
+{
+  thread_pool().resize(threads);
+}
+
+#endif
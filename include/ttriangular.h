@@ -0,0 +1,447 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Верхняя треугольная матрица в упакованном виде и решение треугольных систем
+
+#ifndef __TTriangular_H__
+#define __TTriangular_H__
+
+#include <vector>
+#include <utility>
+#include "tmatrix.h"
+
+// Верхняя треугольная матрица n x n -
+// хранятся только элементы j >= i, строка за строкой: n(n+1)/2 элементов.
+// Сложение, вычитание, умножение на скаляр, матрицу и вектор обрабатывают
+// только хранимую половину. В остальных выражениях матрица участвует
+// как обычная, с нулями под диагональю
+template<typename T, typename Alloc = TAlignedAllocator<T>>
+class TUpperTriangularMatrix : public TMatExpr<TUpperTriangularMatrix<T, Alloc>>
+{
+  size_t sz;
+  TDynamicVector<T, Alloc> elems;
+
+  static size_t check_size(size_t s)
+  {
+    if (s == 0)
+      throw out_of_range("Matrix size should be greater than zero");
+    if (s > MAX_MATRIX_SIZE)
+      throw out_of_range("Matrix size should not exceed MAX_MATRIX_SIZE");
+    return s;
+  }
+  static size_t packed_size(size_t s) { return s * (s + 1) / 2; }
+  // строка i начинается с элемента (i, i); указатель сдвинут на i назад,
+  // чтобы к элементу (i, j) обращаться по индексу j
+  size_t row_offset(size_t i) const noexcept { return i * sz - i * (i + 1) / 2; }
+public:
+  typedef T value_type;
+  typedef TDynamicMatrix<T> matrix_type;
+  typedef Alloc allocator_type;
+
+  TUpperTriangularMatrix(size_t s = 1, const Alloc& a = Alloc())
+    : sz(check_size(s)), elems(packed_size(s), a)
+  {
+  }
+  // элементы не инициализируются
+  TUpperTriangularMatrix(size_t s, TUninitialized, const Alloc& a = Alloc())
+    : sz(check_size(s)), elems(packed_size(s), uninitialized, a)
+  {
+  }
+  // верхняя половина квадратного выражения, нижняя отбрасывается
+  template<typename E>
+  explicit TUpperTriangularMatrix(const TMatExpr<E>& expr, const Alloc& a = Alloc())
+    : sz(check_size(expr.self().rows())), elems(packed_size(sz), uninitialized, a)
+  {
+    const E& e = expr.self();
+    if (e.rows() != e.cols())
+      throw length_error("Triangular matrix requires a square matrix");
+    alignas(MEMORY_ALIGNMENT) T tmp[EXPR_CHUNK];
+    for (size_t i = 0; i < sz; i++)
+      for (size_t j = i; j < sz; j += EXPR_CHUNK)
+      {
+        size_t k = std::min(EXPR_CHUNK, sz - j);
+        const T* src = mat_chunk(e, i, j, k, tmp);
+        std::copy(src, src + k, (*this)[i] + j);
+      }
+  }
+
+  size_t size() const noexcept { return sz; }
+  size_t rows() const noexcept { return sz; }
+  size_t cols() const noexcept { return sz; }
+  Alloc get_allocator() const { return elems.get_allocator(); }
+
+  // m[i][j] - элемент, только для j >= i
+  T* operator[](size_t i) { return elems.data() + row_offset(i); }
+  const T* operator[](size_t i) const { return elems.data() + row_offset(i); }
+
+  // индексация с контролем; элементы под диагональю равны нулю и не изменяются
+  T& at(size_t i, size_t j)
+  {
+    if (i >= sz || j >= sz)
+      throw out_of_range("Matrix index is out of range");
+    if (j < i)
+      throw out_of_range("Element below the diagonal is not stored");
+    return (*this)[i][j];
+  }
+  T at(size_t i, size_t j) const
+  {
+    if (i >= sz || j >= sz)
+      throw out_of_range("Matrix index is out of range");
+    return (*this)(i, j);
+  }
+
+  // интерфейс матричного выражения
+  T operator()(size_t i, size_t j) const { return j < i ? T() : (*this)[i][j]; }
+  const T* row_data(size_t) const noexcept { return nullptr; }
+  void eval_row(size_t i, size_t j0, size_t n, T* out) const
+  {
+    size_t z = i > j0 ? std::min(i - j0, n) : 0;
+    std::fill(out, out + z, T());
+    std::copy((*this)[i] + j0 + z, (*this)[i] + j0 + n, out + z);
+  }
+  template<typename M>
+  void eval_to(M& m) const { mat_assign(*this, m); }
+
+  // сравнение
+  bool operator==(const TUpperTriangularMatrix& m) const noexcept
+  {
+    return sz == m.sz && elems == m.elems;
+  }
+  bool operator!=(const TUpperTriangularMatrix& m) const noexcept
+  {
+    return !(*this == m);
+  }
+
+  // обновление на месте - по упакованным элементам
+  TUpperTriangularMatrix& operator+=(const TUpperTriangularMatrix& m)
+  {
+    if (sz != m.sz)
+      throw length_error("Matrices should have equal sizes");
+    elems += m.elems;
+    return *this;
+  }
+  TUpperTriangularMatrix& operator-=(const TUpperTriangularMatrix& m)
+  {
+    if (sz != m.sz)
+      throw length_error("Matrices should have equal sizes");
+    elems -= m.elems;
+    return *this;
+  }
+  TUpperTriangularMatrix& operator*=(const T& val)
+  {
+    elems *= val;
+    return *this;
+  }
+
+  friend void swap(TUpperTriangularMatrix& lhs, TUpperTriangularMatrix& rhs) noexcept
+  {
+    std::swap(lhs.sz, rhs.sz);
+    swap(lhs.elems, rhs.elems);
+  }
+
+  // ввод - только элементы j >= i по строкам, вывод - вся матрица
+  friend istream& operator>>(istream& istr, TUpperTriangularMatrix& v)
+  {
+    for (size_t i = 0; i < v.sz; i++)
+      for (size_t j = i; j < v.sz; j++)
+        istr >> v[i][j];
+    return istr;
+  }
+  friend ostream& operator<<(ostream& ostr, const TUpperTriangularMatrix& v)
+  {
+    for (size_t i = 0; i < v.sz; i++)
+    {
+      for (size_t j = 0; j < v.sz; j++)
+        ostr << v(i, j) << ' ';
+      ostr << endl;
+    }
+    return ostr;
+  }
+};
+
+template<typename T, typename A>
+TUpperTriangularMatrix<T, A> operator+(TUpperTriangularMatrix<T, A> a, const TUpperTriangularMatrix<T, A>& b)
+{
+  a += b;
+  return a;
+}
+template<typename T, typename A>
+TUpperTriangularMatrix<T, A> operator-(TUpperTriangularMatrix<T, A> a, const TUpperTriangularMatrix<T, A>& b)
+{
+  a -= b;
+  return a;
+}
+template<typename T, typename A>
+TUpperTriangularMatrix<T, A> operator*(TUpperTriangularMatrix<T, A> a, typename TUpperTriangularMatrix<T, A>::value_type val)
+{
+  a *= val;
+  return a;
+}
+template<typename T, typename A>
+TUpperTriangularMatrix<T, A> operator*(typename TUpperTriangularMatrix<T, A>::value_type val, TUpperTriangularMatrix<T, A> a)
+{
+  a *= val;
+  return a;
+}
+
+// Размер блока для произведения треугольных матриц
+const size_t TRIANGULAR_BLOCK = 128;
+
+namespace triangular_detail
+{
+  // c = a * b построчно: строка c(i) - сумма строк b(k) с коэффициентами a(i, k),
+  // k из [i, n); для малых размеров и нечисловых типов
+  template<typename M>
+  void product(const M& a, const M& b, M& c, std::false_type)
+  {
+    typedef typename M::value_type T;
+    size_t n = a.size();
+    for (size_t i = 0; i < n; i++)
+    {
+      T* ci = c[i];
+      const T* ai = a[i];
+      for (size_t k = i; k < n; k++)
+        simd::axpy(ai[k], b[k] + k, ci + k, n - k);
+    }
+  }
+
+  // Блочный вариант: C(I, J) = сумма A(I, K) * B(K, J) по K из [I, J] для блоков
+  // J >= I, каждое слагаемое - вызов gemm. Внедиагональные блоки читаются прямо
+  // из упакованной памяти, диагональные копируются в плотные с нулями под диагональю.
+  // Блоки C независимы и распределяются по потокам общего пула
+  template<typename M>
+  void product(const M& a, const M& b, M& c, std::true_type)
+  {
+    typedef typename M::value_type T;
+    const size_t BS = TRIANGULAR_BLOCK;
+    size_t n = a.size();
+    if (n < 2 * BS)
+    {
+      product(a, b, c, std::false_type());
+      return;
+    }
+    size_t nb = (n + BS - 1) / BS;
+    std::vector<T, TAlignedAllocator<T>> da(nb * BS * BS), db(nb * BS * BS);
+    for (size_t ib = 0; ib < nb; ib++)
+    {
+      size_t i0 = ib * BS, m = std::min(BS, n - i0);
+      for (size_t i = 0; i < m; i++)
+        for (size_t j = i; j < m; j++)
+        {
+          da[(ib * BS + i) * BS + j] = a[i0 + i][i0 + j];
+          db[(ib * BS + i) * BS + j] = b[i0 + i][i0 + j];
+        }
+    }
+    std::vector<std::pair<size_t, size_t>> tiles;
+    for (size_t ib = 0; ib < nb; ib++)
+      for (size_t jb = ib; jb < nb; jb++)
+        tiles.push_back(std::make_pair(ib, jb));
+
+    thread_pool().parallel_for(tiles.size(), [&](size_t t)
+    {
+      size_t ib = tiles[t].first, jb = tiles[t].second;
+      size_t i0 = ib * BS, mi = std::min(BS, n - i0);
+      size_t j0 = jb * BS, mj = std::min(BS, n - j0);
+      // диагональный блок C накапливается отдельно: его нижняя часть не хранится
+      std::vector<T, TAlignedAllocator<T>> cd(ib == jb ? BS * BS : 0);
+      auto rc = [&](size_t i) { return ib == jb ? cd.data() + i * BS : c[i0 + i] + j0; };
+      for (size_t kb = ib; kb <= jb; kb++)
+      {
+        size_t k0 = kb * BS, mk = std::min(BS, n - k0);
+        gemm(mi, mj, mk, T(1),
+          [&](size_t i) { return kb == ib ? da.data() + (ib * BS + i) * BS : a[i0 + i] + k0; },
+          [&](size_t p) { return kb == jb ? db.data() + (kb * BS + p) * BS : b[k0 + p] + j0; },
+          T(1), rc);
+      }
+      if (ib == jb)
+        for (size_t i = 0; i < mi; i++)
+          std::copy(cd.data() + i * BS + i, cd.data() + i * BS + mj, c[i0 + i] + i0 + i);
+    });
+  }
+}
+
+// Произведение верхних треугольных матриц - верхняя треугольная:
+// c(i, j) = сумма a(i, k) * b(k, j) по k из [i, j], около n^3 / 6
+// умножений-сложений вместо n^3
+template<typename T, typename A>
+TUpperTriangularMatrix<T, A> operator*(const TUpperTriangularMatrix<T, A>& a, const TUpperTriangularMatrix<T, A>& b)
+{
+  if (a.size() != b.size())
+    throw length_error("Matrices should have equal sizes");
+  TUpperTriangularMatrix<T, A> c(a.size(), a.get_allocator());
+  triangular_detail::product(a, b, c, std::is_arithmetic<T>());
+  return c;
+}
+
+// Умножение на вектор: y(i) - скалярное произведение хранимой части строки i
+template<typename T, typename A, typename V>
+TDynamicVector<T, A> operator*(const TUpperTriangularMatrix<T, A>& a, const TVecExpr<V>& b)
+{
+  const V& x = b.self();
+  size_t n = a.size();
+  if (n != x.size())
+    throw length_error("Vector size should be equal to matrix column count");
+  std::unique_ptr<TDynamicVector<T>> tmp;
+  const T* px = x.data();
+  if (px == nullptr)
+  {
+    tmp.reset(new TDynamicVector<T>(x));
+    px = tmp->data();
+  }
+  TDynamicVector<T, A> res(n, uninitialized, a.get_allocator());
+  for (size_t i = 0; i < n; i++)
+    res[i] = simd::dot(a[i] + i, px + i, n - i);
+  return res;
+}
+
+// Какая половина матрицы задает треугольную систему
+enum class TTriangle { upper, lower };
+
+// Размер диагонального блока при решении систем с несколькими правыми частями
+const size_t TRSM_BLOCK = 64;
+
+namespace triangular_detail
+{
+  // t(i) - указатель на строку i, элемент (i, j) - t(i)[j]
+  inline size_t check_system(size_t rows, size_t cols, size_t rhs)
+  {
+    if (rows != cols)
+      throw length_error("Triangular matrix requires a square matrix");
+    if (rhs != rows)
+      throw length_error("Right-hand side size should be equal to matrix size");
+    return rows;
+  }
+  template<typename T, typename Row>
+  void check_diagonal(size_t n, Row t)
+  {
+    for (size_t i = 0; i < n; i++)
+      if (t(i)[i] == T())
+        throw domain_error("Triangular matrix is singular");
+  }
+
+  // x = T^-1 x прямой или обратной подстановкой, по скалярному произведению на строку
+  template<typename T, typename Row>
+  void trsv(size_t n, Row t, TTriangle uplo, T* x)
+  {
+    if (uplo == TTriangle::lower)
+      for (size_t i = 0; i < n; i++)
+        x[i] = (x[i] - simd::dot(t(i), x, i)) / t(i)[i];
+    else
+      for (size_t i = n; i-- > 0;)
+        x[i] = (x[i] - simd::dot(t(i) + i + 1, x + i + 1, n - i - 1)) / t(i)[i];
+  }
+
+  // подстановка внутри диагонального блока [k0, k1): x(i) - строка X из r элементов
+  template<typename T, typename Row, typename RowX>
+  void trsm_block(size_t k0, size_t k1, size_t r, Row t, TTriangle uplo, RowX x)
+  {
+    for (size_t s = k0; s < k1; s++)
+    {
+      size_t i = uplo == TTriangle::lower ? s : k0 + k1 - 1 - s;
+      size_t j0 = uplo == TTriangle::lower ? k0 : i + 1;
+      size_t j1 = uplo == TTriangle::lower ? i : k1;
+      const T* ti = t(i);
+      T* xi = x(i);
+      for (size_t j = j0; j < j1; j++)
+        simd::axpy(-ti[j], x(j), xi, r);
+      T d = ti[i];
+      for (size_t j = 0; j < r; j++)
+        xi[j] /= d;
+    }
+  }
+
+  // C -= A * B для оставшихся строк X
+  template<typename T, typename RowA, typename RowB, typename RowC>
+  void trsm_update(size_t m, size_t r, size_t k, RowA a, RowB b, RowC c, std::true_type)
+  {
+    gemm_parallel(m, r, k, T(-1), a, b, T(1), c);
+  }
+  template<typename T, typename RowA, typename RowB, typename RowC>
+  void trsm_update(size_t m, size_t r, size_t k, RowA a, RowB b, RowC c, std::false_type)
+  {
+    for (size_t i = 0; i < m; i++)
+      for (size_t p = 0; p < k; p++)
+        simd::axpy(-a(i)[p], b(p), c(i), r);
+  }
+
+  // X = T^-1 X по блокам из TRSM_BLOCK строк: подстановка идет только внутри
+  // диагонального блока, вклад решенного блока в остальные строки X вычитается
+  // одним умножением матриц. Для нижней треугольной блоки идут сверху вниз,
+  // для верхней - снизу вверх
+  template<typename T, typename Row, typename RowX>
+  void trsm(size_t n, size_t r, Row t, TTriangle uplo, RowX x)
+  {
+    const size_t BS = TRSM_BLOCK;
+    size_t nb = (n + BS - 1) / BS;
+    for (size_t s = 0; s < nb; s++)
+    {
+      size_t kb = uplo == TTriangle::lower ? s : nb - 1 - s;
+      size_t k0 = kb * BS, k1 = std::min(n, k0 + BS);
+      trsm_block<T>(k0, k1, r, t, uplo, x);
+      // строки [i0, i1), которые еще предстоит решить
+      size_t i0 = uplo == TTriangle::lower ? k1 : 0;
+      size_t i1 = uplo == TTriangle::lower ? n : k0;
+      if (i0 < i1)
+        trsm_update<T>(i1 - i0, r, k1 - k0,
+          [&](size_t i) { return t(i0 + i) + k0; },
+          [&](size_t p) { return x(k0 + p); },
+          [&](size_t i) { return x(i0 + i); },
+          std::is_arithmetic<T>());
+    }
+  }
+}
+
+// Решение треугольной системы T * x = b (T * X = B для матрицы правых частей).
+// uplo указывает, какая половина t задает матрицу системы, другая не читается;
+// нулевой элемент на диагонали - исключение domain_error
+template<typename E, typename V>
+TDynamicVector<typename E::value_type> solve_triangular(const TMatExpr<E>& t, TTriangle uplo, const TVecExpr<V>& b)
+{
+  typedef typename E::value_type T;
+  TMatValue<E> tv(t.self());
+  const typename TMatValue<E>::type& m = tv.get();
+  size_t n = triangular_detail::check_system(m.rows(), m.cols(), b.self().size());
+  auto rows = [&m](size_t i) { return m.row_data(i); };
+  triangular_detail::check_diagonal<T>(n, rows);
+  TDynamicVector<T> x(b);
+  triangular_detail::trsv(n, rows, uplo, x.data());
+  return x;
+}
+template<typename E, typename EB>
+TDynamicMatrix<typename E::value_type> solve_triangular(const TMatExpr<E>& t, TTriangle uplo, const TMatExpr<EB>& b)
+{
+  typedef typename E::value_type T;
+  TMatValue<E> tv(t.self());
+  const typename TMatValue<E>::type& m = tv.get();
+  size_t n = triangular_detail::check_system(m.rows(), m.cols(), b.self().rows());
+  auto rows = [&m](size_t i) { return m.row_data(i); };
+  triangular_detail::check_diagonal<T>(n, rows);
+  TDynamicMatrix<T> x(b);
+  triangular_detail::trsm<T>(n, x.cols(), rows, uplo, [&x](size_t i) { return x.row_data(i); });
+  return x;
+}
+
+// то же для упакованной верхней треугольной матрицы
+template<typename T, typename A, typename V>
+TDynamicVector<T, A> solve_triangular(const TUpperTriangularMatrix<T, A>& t, const TVecExpr<V>& b)
+{
+  size_t n = triangular_detail::check_system(t.size(), t.size(), b.self().size());
+  auto rows = [&t](size_t i) { return t[i]; };
+  triangular_detail::check_diagonal<T>(n, rows);
+  TDynamicVector<T, A> x(b, t.get_allocator());
+  triangular_detail::trsv(n, rows, TTriangle::upper, x.data());
+  return x;
+}
+template<typename T, typename A, typename EB>
+TDynamicMatrix<T> solve_triangular(const TUpperTriangularMatrix<T, A>& t, const TMatExpr<EB>& b)
+{
+  size_t n = triangular_detail::check_system(t.size(), t.size(), b.self().rows());
+  auto rows = [&t](size_t i) { return t[i]; };
+  triangular_detail::check_diagonal<T>(n, rows);
+  TDynamicMatrix<T> x(b);
+  triangular_detail::trsm<T>(n, x.cols(), rows, TTriangle::upper, [&x](size_t i) { return x.row_data(i); });
+  return x;
+}
+
+#endif
@@ -0,0 +1,344 @@
+﻿// ННГУ, ИИТММ, Курс "Алгоритмы и структуры данных"
+//
+// Copyright (c) Сысоев А.В.
+//
+// Представления (views) - части векторов и матриц без копирования элементов:
+// указатель на память, размер и шаг. Представление не владеет памятью и
+// действительно, пока жив и не меняет размер вектор (матрица), из которого оно получено
+
+#ifndef __TView_H__
+#define __TView_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "texpr.h"
+
+// Вектор из n элементов p[0], p[inc], ..., p[(n - 1) * inc].
+// Копия представления ссылается на ту же память; присваивание копирует элементы.
+// Для T = const U - представление только для чтения
+template<typename T>
+class TVectorView : public TVecExpr<TVectorView<T>>
+{
+public:
+  typedef typename std::remove_const<T>::type value_type;
+private:
+  T* p;
+  size_t sz;
+  size_t inc;
+
+  // out = out Op e по порциям: элементы с шагом собираются в буфер и записываются обратно
+  template<typename Op, typename E>
+  void update(const E& e)
+  {
+    if (sz != e.size())
+      throw std::length_error("Vectors should have equal sizes");
+    if (inc == 1)
+    {
+      expr_update<Op>(e, p);
+      return;
+    }
+    alignas(MEMORY_ALIGNMENT) value_type cur[EXPR_CHUNK], tmp[EXPR_CHUNK];
+    for (size_t i = 0; i < sz; i += EXPR_CHUNK)
+    {
+      size_t k = std::min(EXPR_CHUNK, sz - i);
+      eval(i, k, cur);
+      Op::apply(cur, expr_chunk(e, i, k, tmp), cur, k);
+      scatter(i, k, cur);
+    }
+  }
+  void scatter(size_t i0, size_t n, const value_type* src)
+  {
+    T* q = p + i0 * inc;
+    for (size_t i = 0; i < n; i++, q += inc)
+      *q = src[i];
+  }
+public:
+  TVectorView(T* ptr, size_t n, size_t step = 1) : p(ptr), sz(n), inc(step)
+  {
+    if (n == 0)
+      throw std::out_of_range("View size should be greater than zero");
+    if (step == 0)
+      throw std::out_of_range("View step should be greater than zero");
+  }
+  TVectorView(const TVectorView&) = default;
+  // неизменяемое представление из изменяемого
+  template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+  TVectorView(const TVectorView<U>& v) : p(v.ptr()), sz(v.size()), inc(v.step()) {}
+
+  size_t size() const noexcept { return sz; }
+  size_t step() const noexcept { return inc; }
+  T* ptr() const noexcept { return p; }
+
+  T& operator[](size_t i) const { return p[i * inc]; }
+  T& at(size_t i) const
+  {
+    if (i >= sz)
+      throw std::out_of_range("Vector index is out of range");
+    return p[i * inc];
+  }
+
+  // интерфейс выражения: элементы подряд доступны напрямую
+  const value_type* data() const noexcept { return inc == 1 ? p : nullptr; }
+  void eval(size_t i0, size_t n, value_type* out) const
+  {
+    const T* q = p + i0 * inc;
+    if (inc == 1)
+      std::copy(q, q + n, out);
+    else
+      for (size_t i = 0; i < n; i++, q += inc)
+        out[i] = *q;
+  }
+
+  // запись выражения в элементы представления
+  TVectorView& operator=(const TVectorView& v)
+  {
+    return *this = static_cast<const TVecExpr<TVectorView>&>(v);
+  }
+  template<typename E>
+  TVectorView& operator=(const TVecExpr<E>& expr)
+  {
+    const E& e = expr.self();
+    if (sz != e.size())
+      throw std::length_error("Vectors should have equal sizes");
+    if (inc == 1)
+    {
+      expr_assign(e, p);
+      return *this;
+    }
+    alignas(MEMORY_ALIGNMENT) value_type cur[EXPR_CHUNK];
+    for (size_t i = 0; i < sz; i += EXPR_CHUNK)
+    {
+      size_t k = std::min(EXPR_CHUNK, sz - i);
+      e.eval(i, k, cur);
+      scatter(i, k, cur);
+    }
+    return *this;
+  }
+
+  template<typename E>
+  TVectorView& operator+=(const TVecExpr<E>& e)
+  {
+    update<TExprAdd>(e.self());
+    return *this;
+  }
+  template<typename E>
+  TVectorView& operator-=(const TVecExpr<E>& e)
+  {
+    update<TExprSub>(e.self());
+    return *this;
+  }
+  TVectorView& operator*=(const value_type& val)
+  {
+    for (size_t i = 0; i < sz; i++)
+      p[i * inc] *= val;
+    return *this;
+  }
+};
+
+// Матрица m x n внутри матрицы с непрерывным хранением:
+// строка i начинается с p + i * ld (ld - шаг строк в элементах).
+// Как и TVectorView, копия ссылается на ту же память, присваивание копирует элементы
+template<typename T>
+class TMatrixView : public TMatExpr<TMatrixView<T>>
+{
+public:
+  typedef typename std::remove_const<T>::type value_type;
+  typedef TDynamicMatrix<value_type> matrix_type;
+  typedef typename matrix_type::allocator_type allocator_type;
+private:
+  T* p;
+  size_t nr, nc;
+  size_t ld;
+
+  void check_size(size_t r, size_t c) const
+  {
+    if (nr != r || nc != c)
+      throw std::length_error("Matrices should have equal sizes");
+  }
+  // пересекается ли память строк x с памятью представления
+  template<typename M>
+  bool overlaps(const M& x) const
+  {
+    uintptr_t lo = reinterpret_cast<uintptr_t>(p);
+    uintptr_t hi = reinterpret_cast<uintptr_t>(p + (nr - 1) * ld + nc);
+    for (size_t i = 0; i < x.rows(); i++)
+    {
+      uintptr_t r = reinterpret_cast<uintptr_t>(x.row_data(i));
+      if (r < hi && r + x.cols() * sizeof(T) > lo)
+        return true;
+    }
+    return false;
+  }
+  // this = alpha * A * B + beta * this прямо в памяти представления;
+  // если сомножитель пересекается с приемником, произведение вычисляется отдельно
+  template<typename L, typename R>
+  void gemm(const TMatProductExpr<L, R>& prod, const value_type& beta)
+  {
+    check_size(prod.rows(), prod.cols());
+    TGemmOperand<L> a(prod.left());
+    TGemmOperand<R> b(prod.right());
+    if (overlaps(a.get()) || overlaps(b.get()))
+    {
+      matrix_type tmp(prod);
+      if (beta == value_type())
+        mat_assign(tmp, *this);
+      else
+      {
+        *this *= beta;
+        mat_update<TExprAdd>(tmp, *this);
+      }
+    }
+    else
+      mat_gemm(prod.scale(), a, b, beta, *this, std::is_arithmetic<value_type>());
+  }
+public:
+  TMatrixView(T* ptr, size_t m, size_t n, size_t step) : p(ptr), nr(m), nc(n), ld(step)
+  {
+    if (m == 0 || n == 0)
+      throw std::out_of_range("View size should be greater than zero");
+    if (step < n)
+      throw std::out_of_range("Row step should not be less than view width");
+  }
+  TMatrixView(const TMatrixView&) = default;
+  template<typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+  TMatrixView(const TMatrixView<U>& m) : p(m.ptr()), nr(m.rows()), nc(m.cols()), ld(m.step()) {}
+
+  size_t rows() const noexcept { return nr; }
+  size_t cols() const noexcept { return nc; }
+  size_t step() const noexcept { return ld; }
+  T* ptr() const noexcept { return p; }
+  allocator_type get_allocator() const { return allocator_type(); }
+
+  // m[i] - указатель на строку, m[i][j] - элемент
+  T* operator[](size_t i) const { return p + i * ld; }
+  T& at(size_t i, size_t j) const
+  {
+    if (i >= nr || j >= nc)
+      throw std::out_of_range("Matrix index is out of range");
+    return p[i * ld + j];
+  }
+
+  // части представления
+  TVectorView<T> row(size_t i) const
+  {
+    if (i >= nr)
+      throw std::out_of_range("Matrix index is out of range");
+    return TVectorView<T>(p + i * ld, nc);
+  }
+  TVectorView<T> col(size_t j) const
+  {
+    if (j >= nc)
+      throw std::out_of_range("Matrix index is out of range");
+    return TVectorView<T>(p + j, nr, ld);
+  }
+  TMatrixView block(size_t i0, size_t j0, size_t m, size_t n) const
+  {
+    if (m == 0 || n == 0 || i0 >= nr || j0 >= nc || m > nr - i0 || n > nc - j0)
+      throw std::out_of_range("Block is out of matrix");
+    return TMatrixView(p + i0 * ld + j0, m, n, ld);
+  }
+  TMatrixView block(size_t i0, size_t j0, size_t n) const { return block(i0, j0, n, n); }
+
+  // интерфейс матричного выражения
+  value_type operator()(size_t i, size_t j) const { return p[i * ld + j]; }
+  T* row_data(size_t i) const noexcept { return p + i * ld; }
+  void eval_row(size_t i, size_t j0, size_t n, value_type* out) const
+  {
+    const T* r = p + i * ld + j0;
+    std::copy(r, r + n, out);
+  }
+  template<typename M>
+  void eval_to(M& m) const { mat_assign(*this, m); }
+
+  // запись выражения в элементы представления;
+  // выражение вычисляется по строкам сверху вниз, поэтому оно может
+  // ссылаться на память представления только в тех же позициях
+  // (произведения и транспонирование вычисляются отдельно и так не ограничены)
+  TMatrixView& operator=(const TMatrixView& m)
+  {
+    check_size(m.rows(), m.cols());
+    if (m.ptr() != p && overlaps(m))
+      mat_assign(matrix_type(m), *this);
+    else if (m.ptr() != p)
+      mat_assign(m, *this);
+    return *this;
+  }
+  template<typename E>
+  TMatrixView& operator=(const TMatExpr<E>& e)
+  {
+    check_size(e.self().rows(), e.self().cols());
+    mat_assign(e.self(), *this);
+    return *this;
+  }
+  template<typename L, typename R>
+  TMatrixView& operator=(const TMatProductExpr<L, R>& prod)
+  {
+    gemm(prod, value_type());
+    return *this;
+  }
+
+  template<typename E>
+  TMatrixView& operator+=(const TMatExpr<E>& e)
+  {
+    check_size(e.self().rows(), e.self().cols());
+    mat_update<TExprAdd>(e.self(), *this);
+    return *this;
+  }
+  template<typename E>
+  TMatrixView& operator-=(const TMatExpr<E>& e)
+  {
+    check_size(e.self().rows(), e.self().cols());
+    mat_update<TExprSub>(e.self(), *this);
+    return *this;
+  }
+  template<typename E>
+  TMatrixView& operator+=(const TMatScalarExpr<TExprMulScalar, E>& e)
+  {
+    check_size(e.rows(), e.cols());
+    mat_axpy(e.scalar(), e.expr(), *this);
+    return *this;
+  }
+  template<typename E>
+  TMatrixView& operator-=(const TMatScalarExpr<TExprMulScalar, E>& e)
+  {
+    check_size(e.rows(), e.cols());
+    mat_axpy(-e.scalar(), e.expr(), *this);
+    return *this;
+  }
+  // блочные алгоритмы: C_ij += A_ik * B_kj без временной матрицы
+  template<typename L, typename R>
+  TMatrixView& operator+=(const TMatProductExpr<L, R>& prod)
+  {
+    gemm(prod, value_type(1));
+    return *this;
+  }
+  template<typename L, typename R>
+  TMatrixView& operator-=(const TMatProductExpr<L, R>& prod)
+  {
+    gemm(TMatProductExpr<L, R>(prod.left(), prod.right(), -prod.scale()), value_type(1));
+    return *this;
+  }
+  TMatrixView& operator*=(const value_type& val)
+  {
+    for (size_t i = 0; i < nr; i++)
+      simd::mul_scalar(p + i * ld, val, p + i * ld, nc);
+    return *this;
+  }
+};
+
+// представление в произведении используется напрямую, без копирования
+template<typename T>
+class TMatValue<TMatrixView<T>>
+{
+  const TMatrixView<T>& m;
+public:
+  typedef TMatrixView<T> type;
+
+  explicit TMatValue(const TMatrixView<T>& matr) : m(matr) {}
+  const TMatrixView<T>& get() const noexcept { return m; }
+};
+
+#endif
@@ -5,12 +5,14 @@
 // Тестирование матриц
 
 #include <iostream>
-#include "tmatrix.h"
+#include "ttriangular.h"
 //---------------------------------------------------------------------------
 
-void main()
+int main()
 {
-  TDynamicMatrix<int> a(5), b(5), c(5);
+  // заполняются только элементы j >= i - матрицы верхние треугольные
+  // и хранятся в упакованном виде
+  TUpperTriangularMatrix<int> a(5), b(5), c(5);
   int i, j;
 
   setlocale(LC_ALL, "Russian");
@@ -26,5 +28,6 @@ void main()
   cout << "Matrix a = " << endl << a << endl;
   cout << "Matrix b = " << endl << b << endl;
   cout << "Matrix c = a + b" << endl << c << endl;
+  return 0;
 }
 //---------------------------------------------------------------------------
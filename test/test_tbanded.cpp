@@ -0,0 +1,156 @@
+#include "tbanded.h"
+
+#include <cmath>
+#include <sstream>
+#include <gtest.h>
+
+typedef TBandMatrix<int> TBandInt;
+
+// ленточная матрица с элементами (i + 2j) % 7 - 3 в ленте
+static TBandInt make_band(size_t n, size_t kl, size_t ku)
+{
+  TBandInt m(n, kl, ku);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = m.first(i); j <= m.last(i); j++)
+      m[i][j] = int((i + 2 * j) % 7) - 3;
+  return m;
+}
+
+// максимум |a * x - b|
+template<typename T>
+static double residual(const TBandMatrix<T>& a, const TDynamicVector<T>& x, const TDynamicVector<T>& b)
+{
+  TDynamicVector<T> r = a * x - b;
+  double err = 0;
+  for (size_t i = 0; i < r.size(); i++)
+    err = std::max(err, double(std::abs(r[i])));
+  return err;
+}
+
+TEST(TBandMatrix, can_create_matrix_with_valid_bandwidths)
+{
+  ASSERT_NO_THROW(TBandInt m(5, 1, 2));
+  ASSERT_NO_THROW(TBandInt m(5, 4, 0));
+  ASSERT_ANY_THROW(TBandInt m(0, 0, 0));
+  ASSERT_ANY_THROW(TBandInt m(5, 5, 1));
+  ASSERT_ANY_THROW(TBandInt m(MAX_VECTOR_SIZE, 2, 2));
+}
+
+TEST(TBandMatrix, elements_outside_band_are_zero)
+{
+  TBandInt m = make_band(6, 1, 2);
+  const TBandInt& c = m;
+
+  EXPECT_EQ(0, c.at(3, 1));
+  EXPECT_EQ(0, c.at(1, 4));
+  EXPECT_EQ(m[3][2], c.at(3, 2));
+  ASSERT_ANY_THROW(m.at(3, 1));
+  ASSERT_ANY_THROW(m.at(1, 4));
+  ASSERT_NO_THROW(m.at(1, 3) = 5);
+  ASSERT_ANY_THROW(c.at(6, 0));
+}
+
+TEST(TBandMatrix, converts_to_and_from_dense_matrix)
+{
+  const size_t n = 20;
+  TBandInt m = make_band(n, 2, 3);
+  TDynamicMatrix<int> d = m;
+
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      EXPECT_EQ(j + 2 < i || j > i + 3 ? 0 : int((i + 2 * j) % 7) - 3, d[i][j]);
+  EXPECT_EQ(m, TBandInt(d, 2, 3));
+}
+
+TEST(TBandMatrix, can_add_subtract_and_scale)
+{
+  TBandInt a = make_band(10, 1, 1), b = make_band(10, 1, 1);
+  TDynamicMatrix<int> d = a;
+
+  EXPECT_EQ(TBandInt(d + d, 1, 1), a + b);
+  EXPECT_EQ(TBandInt(10, 1, 1), a - b);
+  EXPECT_EQ(TBandInt(d * 3, 1, 1), 3 * a);
+  ASSERT_ANY_THROW(a + TBandInt(10, 1, 2));
+}
+
+TEST(TBandMatrix, can_multiply_by_vector)
+{
+  const size_t n = 50;
+  TBandInt a = make_band(n, 2, 1);
+  TDynamicVector<int> x(n);
+  for (size_t i = 0; i < n; i++)
+    x[i] = int(i % 3) - 1;
+  TDynamicMatrix<int> d = a;
+
+  EXPECT_EQ(d * x, a * x);
+  EXPECT_EQ(d * (x + x), a * (x + x));
+  ASSERT_ANY_THROW(a * TDynamicVector<int>(n + 1));
+}
+
+TEST(TBandMatrix, lu_solves_system_with_pivoting)
+{
+  // нули на диагонали: без перестановок разложение невозможно
+  const size_t n = 200;
+  TBandMatrix<double> a(n, 2, 3);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = a.first(i); j <= a.last(i); j++)
+      a[i][j] = i == j ? 0.0 : 1.0 + double((i * 3 + j) % 5);
+  TDynamicVector<double> b(n);
+  for (size_t i = 0; i < n; i++)
+    b[i] = double(i % 7) - 3;
+  TBandLU<double> lu(a);
+  TDynamicVector<double> x = lu.solve(b);
+
+  // матрица плохо обусловлена: невязка сравнивается с величиной решения
+  double xmax = 0;
+  for (size_t i = 0; i < n; i++)
+    xmax = std::max(xmax, std::abs(x[i]));
+  EXPECT_LT(residual(a, x, b), 1e-13 * xmax);
+  EXPECT_EQ(5u, lu.factors().upper());
+  ASSERT_ANY_THROW(lu.solve(TDynamicVector<double>(n + 1)));
+}
+
+TEST(TBandMatrix, lu_throws_when_matrix_is_singular)
+{
+  TBandMatrix<double> a(4, 1, 1);
+  a[0][0] = a[1][1] = a[3][3] = 1;
+
+  ASSERT_ANY_THROW(TBandLU<double> lu(a));
+}
+
+TEST(TBandMatrix, thomas_algorithm_solves_tridiagonal_system)
+{
+  // 10^6 неизвестных: в плотном виде матрица не помещается
+  const size_t n = 1000000;
+  TBandMatrix<double> a(n, 1, 1);
+  TDynamicVector<double> x(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    a[i][i] = 4;
+    if (i > 0)
+      a[i][i - 1] = -1;
+    if (i + 1 < n)
+      a[i][i + 1] = -1;
+    x[i] = double(i % 7);
+  }
+  TDynamicVector<double> b = a * x;
+  TDynamicVector<double> y = solve_tridiagonal(a, b);
+
+  double err = 0;
+  for (size_t i = 0; i < n; i++)
+    err = std::max(err, std::abs(x[i] - y[i]));
+  EXPECT_LT(err, 1e-9);
+  EXPECT_LT(residual(a, TBandLU<double>(a).solve(b), b), 1e-9);
+  ASSERT_ANY_THROW(solve_tridiagonal(TBandMatrix<double>(5, 2, 1), TDynamicVector<double>(5)));
+}
+
+TEST(TBandMatrix, input_reads_band_and_output_prints_matrix)
+{
+  TBandInt a(3, 1, 0);
+  std::istringstream is("1 2 3 4 5");
+  is >> a;
+  std::ostringstream os;
+  os << a;
+
+  EXPECT_EQ("1 0 0 \n2 3 0 \n0 4 5 \n", os.str());
+}
@@ -1,5 +1,6 @@
-#include "tmatrix.h"
+﻿#include "tmatrix.h"
 
+#include <sstream>
 #include <gtest.h>
 
 TEST(TDynamicMatrix, can_create_matrix_with_positive_length)
@@ -26,86 +27,847 @@ TEST(TDynamicMatrix, can_create_copied_matrix)
 
 TEST(TDynamicMatrix, copied_matrix_is_equal_to_source_one)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3);
+  m[1][2] = 5;
+  TDynamicMatrix<int> m1(m);
+
+  EXPECT_EQ(m, m1);
 }
 
 TEST(TDynamicMatrix, copied_matrix_has_its_own_memory)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3);
+  TDynamicMatrix<int> m1(m);
+  m1[1][2] = 5;
+
+  EXPECT_EQ(0, m[1][2]);
+  EXPECT_NE(&m[1][2], &m1[1][2]);
 }
 
 TEST(TDynamicMatrix, can_get_size)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3);
+
+  EXPECT_EQ(3u, m.size());
 }
 
 TEST(TDynamicMatrix, can_set_and_get_element)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3);
+  m[2][1] = 4;
+
+  EXPECT_EQ(4, m[2][1]);
+  EXPECT_EQ(4, m.at(2, 1));
 }
 
 TEST(TDynamicMatrix, throws_when_set_element_with_negative_index)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3);
+
+  ASSERT_ANY_THROW(m.at(-1, 0) = 1);
 }
 
 TEST(TDynamicMatrix, throws_when_set_element_with_too_large_index)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3);
+
+  ASSERT_ANY_THROW(m.at(0, 3) = 1);
 }
 
 TEST(TDynamicMatrix, can_assign_matrix_to_itself)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3);
+  m[0][0] = 1;
+  m = m;
+
+  EXPECT_EQ(1, m[0][0]);
 }
 
 TEST(TDynamicMatrix, can_assign_matrices_of_equal_size)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3), m1(3);
+  m[0][1] = 1;
+  m1 = m;
+
+  EXPECT_EQ(m, m1);
 }
 
 TEST(TDynamicMatrix, assign_operator_change_matrix_size)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3), m1(2);
+  m1 = m;
+
+  EXPECT_EQ(3u, m1.size());
 }
 
 TEST(TDynamicMatrix, can_assign_matrices_of_different_size)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3), m1(2);
+  m[2][2] = 1;
+  m1 = m;
+
+  EXPECT_EQ(m, m1);
 }
 
 TEST(TDynamicMatrix, compare_equal_matrices_return_true)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3), m1(3);
+  m[1][1] = m1[1][1] = 2;
+
+  EXPECT_TRUE(m == m1);
 }
 
 TEST(TDynamicMatrix, compare_matrix_with_itself_return_true)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3);
+
+  EXPECT_TRUE(m == m);
 }
 
 TEST(TDynamicMatrix, matrices_with_different_size_are_not_equal)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(3), m1(4);
+
+  EXPECT_NE(m, m1);
 }
 
 TEST(TDynamicMatrix, can_add_matrices_with_equal_size)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(2), m1(2);
+  m[0][0] = 1; m[1][1] = 2;
+  m1[0][0] = 3; m1[0][1] = 4;
+  TDynamicMatrix<int> res = m + m1;
+
+  EXPECT_EQ(4, res[0][0]);
+  EXPECT_EQ(4, res[0][1]);
+  EXPECT_EQ(0, res[1][0]);
+  EXPECT_EQ(2, res[1][1]);
 }
 
 TEST(TDynamicMatrix, cant_add_matrices_with_not_equal_size)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(2), m1(3);
+
+  ASSERT_ANY_THROW(m + m1);
 }
 
 TEST(TDynamicMatrix, can_subtract_matrices_with_equal_size)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(2), m1(2);
+  m[0][0] = 1; m1[0][0] = 3; m1[1][0] = 4;
+  TDynamicMatrix<int> res = m - m1;
+
+  EXPECT_EQ(-2, res[0][0]);
+  EXPECT_EQ(-4, res[1][0]);
 }
 
 TEST(TDynamicMatrix, cant_subtract_matrixes_with_not_equal_size)
 {
-  ADD_FAILURE();
+  TDynamicMatrix<int> m(2), m1(3);
+
+  ASSERT_ANY_THROW(m - m1);
+}
+
+TEST(TDynamicMatrix, can_multiply_matrix_by_scalar)
+{
+  TDynamicMatrix<int> m(2);
+  m[0][1] = 3;
+
+  EXPECT_EQ(6, (m * 2)[0][1]);
+}
+
+TEST(TDynamicMatrix, can_multiply_matrix_by_vector)
+{
+  TDynamicMatrix<int> m(2);
+  m[0][0] = 1; m[0][1] = 2; m[1][0] = 3; m[1][1] = 4;
+  int a[] = { 1, 1 }, b[] = { 3, 7 };
+  TDynamicVector<int> v(a, 2), expected(b, 2);
+
+  EXPECT_EQ(expected, m * v);
+}
+
+TEST(TDynamicMatrix, can_multiply_matrices_with_equal_size)
+{
+  TDynamicMatrix<int> m(2), m1(2);
+  m[0][0] = 1; m[0][1] = 2; m[1][0] = 3; m[1][1] = 4;
+  m1[0][0] = 5; m1[0][1] = 6; m1[1][0] = 7; m1[1][1] = 8;
+  TDynamicMatrix<int> res = m * m1;
+
+  EXPECT_EQ(19, res[0][0]);
+  EXPECT_EQ(22, res[0][1]);
+  EXPECT_EQ(43, res[1][0]);
+  EXPECT_EQ(50, res[1][1]);
+}
+
+TEST(TDynamicMatrix, cant_multiply_matrices_with_not_equal_size)
+{
+  TDynamicMatrix<int> m(2), m1(3);
+
+  ASSERT_ANY_THROW(m * m1);
+}
+
+typedef TDynamicMatrix<int, TContiguousStorage<int>> TContiguousIntMatrix;
+
+TEST(TDynamicMatrix, contiguous_storage_keeps_rows_in_one_block)
+{
+  TContiguousIntMatrix m(3);
+  ptrdiff_t stride = &m[1][0] - &m[0][0];
+
+  EXPECT_GE(stride, 3);
+  EXPECT_EQ(&m[0][0] + 2 * stride, &m[2][0]);
+  EXPECT_EQ(&m[0][0] + 2 * stride + 2, &m[2][2]);
+}
+
+TEST(TDynamicMatrix, contiguous_storage_rows_are_aligned)
+{
+  TDynamicMatrix<double, TContiguousStorage<double>> m(13), c(m);
+  m[12][12] = 1;
+  c = m + m;
+
+  for (size_t i = 0; i < 13; i++)
+  {
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(&m[i][0]) % MEMORY_ALIGNMENT);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(&c[i][0]) % MEMORY_ALIGNMENT);
+  }
+  EXPECT_EQ(2, c[12][12]);
+  EXPECT_NE(m, c);
 }
 
+TEST(TDynamicMatrix, contiguous_storage_copy_has_its_own_memory)
+{
+  TContiguousIntMatrix m(3);
+  TContiguousIntMatrix m1(m);
+  m1[1][2] = 5;
+
+  EXPECT_EQ(0, m[1][2]);
+  EXPECT_NE(m, m1);
+}
+
+TEST(TDynamicMatrix, contiguous_storage_gives_same_results)
+{
+  TDynamicMatrix<int> a(3), b(3);
+  TContiguousIntMatrix ca(3), cb(3);
+  for (size_t i = 0; i < 3; i++)
+    for (size_t j = 0; j < 3; j++)
+    {
+      a[i][j] = ca[i][j] = i * 3 + j;
+      b[i][j] = cb[i][j] = i - j;
+    }
+  TDynamicMatrix<int> sum = a + b, prod = a * b;
+  TContiguousIntMatrix csum = ca + cb, cprod = ca * cb;
+
+  for (size_t i = 0; i < 3; i++)
+    for (size_t j = 0; j < 3; j++)
+    {
+      EXPECT_EQ(sum[i][j], csum[i][j]);
+      EXPECT_EQ(prod[i][j], cprod[i][j]);
+    }
+}
+
+TEST(TDynamicMatrix, blocked_multiplication_matches_naive_one)
+{
+  const size_t n = 131;
+  TDynamicMatrix<double> a(n), b(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      a[i][j] = double((i * 7 + j * 3) % 11) - 5;
+      b[i][j] = double((i * 5 + j) % 13) / 4;
+    }
+  TDynamicMatrix<double> c = a * b;
+
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      double s = 0;
+      for (size_t k = 0; k < n; k++)
+        s += a[i][k] * b[k][j];
+      ASSERT_DOUBLE_EQ(s, c[i][j]);
+    }
+}
+
+TEST(TDynamicMatrix, blocked_multiplication_is_exact_for_integers)
+{
+  const size_t n = 300;
+  TDynamicMatrix<int, TContiguousStorage<int>> a(n), e(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    a[i][i] = 2;
+    e[i][(i + 1) % n] = 1;
+  }
+  TDynamicMatrix<int, TContiguousStorage<int>> c = a * e;
+
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      ASSERT_EQ(j == (i + 1) % n ? 2 : 0, c[i][j]);
+}
+
+TEST(TDynamicMatrix, matrix_expression_is_evaluated_on_assignment)
+{
+  const size_t n = 5;
+  TDynamicMatrix<int> a(n), b(n), c(n), res(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      a[i][j] = int(i + j);
+      b[i][j] = int(i * j);
+      c[i][j] = int(i) - int(j);
+    }
+  res = a + b - c * 2;
+
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      EXPECT_EQ(a[i][j] + b[i][j] - 2 * c[i][j], res[i][j]);
+}
+
+TEST(TDynamicMatrix, can_get_element_of_matrix_expression)
+{
+  TDynamicMatrix<int> a(2), b(2);
+  a[1][0] = 3;
+  b[1][0] = 4;
+
+  EXPECT_EQ(7, (a + b)[1][0]);
+  EXPECT_EQ(-2, (2 * (a - b))[1][0]);
+}
+
+TEST(TDynamicMatrix, matrix_expression_can_use_result_as_operand)
+{
+  TDynamicMatrix<int> a(3), b(3);
+  for (size_t i = 0; i < 3; i++)
+    for (size_t j = 0; j < 3; j++)
+    {
+      a[i][j] = int(i * 3 + j);
+      b[i][j] = 1;
+    }
+  TDynamicMatrix<int> expected(a);
+  for (size_t i = 0; i < 3; i++)
+    for (size_t j = 0; j < 3; j++)
+      expected[i][j] = (a[i][j] - 1) * 3 + a[i][j];
+  a = (a - b) * 3 + a;
+
+  EXPECT_EQ(expected, a);
+}
+
+TEST(TDynamicMatrix, can_transpose_matrix)
+{
+  const size_t n = 70;
+  TDynamicMatrix<int> a(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      a[i][j] = int(i * n + j);
+  TDynamicMatrix<int> t = transpose(a);
+  TDynamicMatrix<int> s(a);
+  s = transpose(s);
+
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      ASSERT_EQ(a[j][i], t[i][j]);
+      ASSERT_EQ(a[j][i], s[i][j]);
+    }
+}
+
+TEST(TDynamicMatrix, can_use_transposed_matrix_in_expression)
+{
+  TDynamicMatrix<int> a(3), b(3);
+  for (size_t i = 0; i < 3; i++)
+    for (size_t j = 0; j < 3; j++)
+    {
+      a[i][j] = int(i * 3 + j);
+      b[i][j] = int(i);
+    }
+  TDynamicMatrix<int> ab = a * b;
+  TDynamicMatrix<int> res = transpose(a * b) + a;
+  a = a + transpose(a);
+
+  for (size_t i = 0; i < 3; i++)
+    for (size_t j = 0; j < 3; j++)
+    {
+      EXPECT_EQ(int(i * 3 + j + j * 3 + i), a[i][j]);
+      EXPECT_EQ(ab[j][i] + int(i * 3 + j), res[i][j]);
+    }
+}
+
+TEST(TDynamicMatrix, can_transpose_matrix_in_place)
+{
+  const size_t n = 37;
+  TDynamicMatrix<int, TContiguousStorage<int>> a(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      a[i][j] = int(i * n + j);
+  TDynamicMatrix<int, TContiguousStorage<int>> t = transpose(a);
+  a = transpose(a);
+
+  EXPECT_EQ(t, a);
+  EXPECT_EQ(int(n), a[0][1]);
+}
+
+TEST(TDynamicMatrix, product_with_transposed_operands_matches_explicit_transpose)
+{
+  // 20 - простой алгоритм, 70 - блочный, 150 - блочный в нескольких потоках
+  const size_t sizes[] = { 20, 70, 150 };
+  for (size_t n : sizes)
+  {
+    TDynamicMatrix<int> a(n), b(n);
+    for (size_t i = 0; i < n; i++)
+      for (size_t j = 0; j < n; j++)
+      {
+        a[i][j] = int((i * 7 + j * 3) % 11) - 5;
+        b[i][j] = int((i * 5 + j) % 9) - 4;
+      }
+    TDynamicMatrix<int> at = transpose(a), bt = transpose(b);
+
+    EXPECT_EQ(TDynamicMatrix<int>(at * b), TDynamicMatrix<int>(transpose(a) * b));
+    EXPECT_EQ(TDynamicMatrix<int>(a * bt), TDynamicMatrix<int>(a * transpose(b)));
+    EXPECT_EQ(TDynamicMatrix<int>(at * bt), TDynamicMatrix<int>(transpose(a) * transpose(b)));
+    EXPECT_EQ(TDynamicMatrix<int>(at * b * 2 + a), TDynamicMatrix<int>(2 * transpose(a) * b + a));
+  }
+}
+
+TEST(TDynamicMatrix, can_multiply_transposed_matrix_by_vector)
+{
+  const size_t n = 5;
+  TDynamicMatrix<int> a(n);
+  TDynamicVector<int> x(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    x[i] = int(i);
+    for (size_t j = 0; j < n; j++)
+      a[i][j] = int(i * n + j);
+  }
+  TDynamicMatrix<int> at = transpose(a);
+
+  EXPECT_EQ(at * x, transpose(a) * x);
+  EXPECT_EQ(at * (x + x), transpose(a) * (x + x));
+}
+
+TEST(TDynamicMatrix, fused_multiply_add_accumulates_into_result)
+{
+  const size_t n = 97;
+  TDynamicMatrix<double> a(n), b(n), c(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      a[i][j] = double((i * 7 + j * 3) % 11) - 5;
+      b[i][j] = double((i * 5 + j) % 13) / 4;
+      c[i][j] = double(i) - double(j);
+    }
+  TDynamicMatrix<double> c0(c);
+  c = 2.0 * a * b + 0.5 * c;
+  TDynamicMatrix<double> d = c0 - a * b * 3.0;
+
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      double s = 0;
+      for (size_t k = 0; k < n; k++)
+        s += a[i][k] * b[k][j];
+      ASSERT_DOUBLE_EQ(2 * s + 0.5 * c0[i][j], c[i][j]);
+      ASSERT_DOUBLE_EQ(c0[i][j] - 3 * s, d[i][j]);
+    }
+}
+
+TEST(TDynamicMatrix, can_assign_product_to_its_operand)
+{
+  TDynamicMatrix<int> a(2), b(2);
+  a[0][0] = 1; a[0][1] = 2;
+  a[1][0] = 3; a[1][1] = 4;
+  b[0][0] = 0; b[0][1] = 1;
+  b[1][0] = 1; b[1][1] = 0;
+  a = a * b + a;
+  b = a * b;
+
+  EXPECT_EQ(3, a[0][0]);
+  EXPECT_EQ(3, a[0][1]);
+  EXPECT_EQ(7, a[1][0]);
+  EXPECT_EQ(7, a[1][1]);
+  EXPECT_EQ(3, b[0][0]);
+  EXPECT_EQ(7, b[1][1]);
+}
+
+TEST(TDynamicMatrix, can_multiply_matrix_expression_by_vector_expression)
+{
+  TDynamicMatrix<int> a(2);
+  TDynamicVector<int> u(2), v(2);
+  a[0][0] = 1; a[0][1] = 2;
+  a[1][0] = 3; a[1][1] = 4;
+  u[0] = 1; v[1] = 1;
+  TDynamicVector<int> res = (a + a) * (u + v);
+
+  EXPECT_EQ(6, res[0]);
+  EXPECT_EQ(14, res[1]);
+}
+
+TEST(TDynamicMatrix, can_update_matrix_in_place)
+{
+  TDynamicMatrix<int> a(3), b(3);
+  for (size_t i = 0; i < 3; i++)
+    for (size_t j = 0; j < 3; j++)
+    {
+      a[i][j] = int(i * 3 + j);
+      b[i][j] = 1;
+    }
+  const int* mem = &a[0][0];
+  a += b;
+  a -= b * 3;
+  a *= 2;
+  a -= transpose(b);
+
+  EXPECT_EQ(mem, &a[0][0]);
+  for (size_t i = 0; i < 3; i++)
+    for (size_t j = 0; j < 3; j++)
+      EXPECT_EQ(int(i * 3 + j - 2) * 2 - 1, a[i][j]);
+}
+
+TEST(TDynamicMatrix, can_accumulate_product_in_place)
+{
+  const size_t n = 90;
+  TDynamicMatrix<double, TContiguousStorage<double>> a(n), b(n), c(n), c0(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      a[i][j] = double((i + 2 * j) % 7) - 3;
+      b[i][j] = double((3 * i + j) % 5);
+      c[i][j] = c0[i][j] = double(i * j % 10);
+    }
+  TDynamicMatrix<double, TContiguousStorage<double>> ab = a * b;
+  const double* mem = &c[0][0];
+  c += a * b;
+  c -= 0.5 * a * b;
+  axpy(2.0, c0, c);
+  a += a * b;
+
+  EXPECT_EQ(mem, &c[0][0]);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      ASSERT_DOUBLE_EQ(3 * c0[i][j] + 0.5 * ab[i][j], c[i][j]);
+      ASSERT_DOUBLE_EQ(double((i + 2 * j) % 7) - 3 + ab[i][j], a[i][j]);
+    }
+}
+
+TEST(TDynamicMatrix, cant_update_matrix_with_not_equal_size)
+{
+  TDynamicMatrix<int> a(3), b(4);
+
+  ASSERT_ANY_THROW(a += b);
+  ASSERT_ANY_THROW(a -= 2 * b);
+  ASSERT_ANY_THROW(a += b * b);
+}
+
+TEST(TDynamicMatrix, arithmetic_with_temporary_reuses_its_memory)
+{
+  TDynamicMatrix<int> a(2), b(2);
+  a[0][0] = 1; a[0][1] = 2;
+  a[1][0] = 3; a[1][1] = 4;
+  b[0][1] = 1; b[1][0] = 1;
+  TDynamicMatrix<int> t(a), u(a);
+  const int* mem = &t[0][0];
+  const int* umem = &u[0][0];
+  TDynamicMatrix<int> r = std::move(t) + a * b - b;
+  TDynamicMatrix<int> s = a * b - std::move(u) * 2;
+
+  EXPECT_EQ(mem, &r[0][0]);
+  EXPECT_EQ(umem, &s[0][0]);
+  EXPECT_EQ(3, r[0][0]);
+  EXPECT_EQ(2, r[0][1]);
+  EXPECT_EQ(6, r[1][0]);
+  EXPECT_EQ(7, r[1][1]);
+  EXPECT_EQ(0, s[0][0]);
+  EXPECT_EQ(-3, s[0][1]);
+  EXPECT_EQ(-2, s[1][0]);
+  EXPECT_EQ(-5, s[1][1]);
+}
+
+namespace
+{
+  // распределитель, считающий занятые блоки памяти
+  template<typename T>
+  struct TCountingAllocator
+  {
+    typedef T value_type;
+    int* blocks;
+
+    TCountingAllocator(int* b = nullptr) : blocks(b) {}
+    template<typename U>
+    TCountingAllocator(const TCountingAllocator<U>& a) : blocks(a.blocks) {}
+
+    T* allocate(size_t n)
+    {
+      if (blocks != nullptr)
+        ++*blocks;
+      return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n)
+    {
+      if (blocks != nullptr)
+        --*blocks;
+      std::allocator<T>().deallocate(p, n);
+    }
+  };
+  template<typename T, typename U>
+  bool operator==(const TCountingAllocator<T>& a, const TCountingAllocator<U>& b) { return a.blocks == b.blocks; }
+  template<typename T, typename U>
+  bool operator!=(const TCountingAllocator<T>& a, const TCountingAllocator<U>& b) { return a.blocks != b.blocks; }
+}
+
+TEST(TDynamicMatrix, allocates_memory_through_allocator)
+{
+  typedef TCountingAllocator<double> A;
+  typedef TDynamicMatrix<double, TContiguousStorage<double, A>> M;
+  int blocks = 0;
+  {
+    M a(100, A(&blocks)), b(a);
+    EXPECT_EQ(2, blocks);
+    M c(a * b + a, A(&blocks));
+    EXPECT_EQ(3, blocks);
+    a = transpose(a);
+    a = M(50, A(&blocks)) * 2.0;
+    TDynamicVector<double, A> v = a * TDynamicVector<double>(50);
+    EXPECT_EQ(4, blocks);
+  }
+  EXPECT_EQ(0, blocks);
+}
+
+TEST(TDynamicMatrix, row_storage_allocates_rows_through_allocator)
+{
+  typedef TCountingAllocator<int> A;
+  int blocks = 0;
+  {
+    TDynamicMatrix<int, TRowStorage<int, A>> a(3, A(&blocks));
+    EXPECT_EQ(1 + 3, blocks);
+    TDynamicMatrix<int, TRowStorage<int, A>> b(a + a, a.get_allocator());
+    EXPECT_EQ(2 * (1 + 3), blocks);
+  }
+  EXPECT_EQ(0, blocks);
+}
+
+TEST(TDynamicMatrix, can_create_uninitialized_matrix)
+{
+  TDynamicMatrix<int> a(5, uninitialized);
+  TDynamicMatrix<int, TContiguousStorage<int>> b(5, uninitialized);
+  for (size_t i = 0; i < 5; i++)
+    for (size_t j = 0; j < 5; j++)
+      a[i][j] = b[i][j] = int(i + j);
+
+  EXPECT_EQ(8, a[4][4]);
+  EXPECT_EQ(8, b[4][4]);
+  ASSERT_ANY_THROW(TDynamicMatrix<int>(0, uninitialized));
+}
+
+TEST(TDynamicMatrix, large_contiguous_matrix_is_zero_initialized)
+{
+  const size_t n = 1500;
+  TDynamicMatrix<double, TContiguousStorage<double>> m(n);
+
+  for (size_t i = 0; i < n; i += 37)
+    for (size_t j = 0; j < n; j += 41)
+      ASSERT_EQ(0.0, m[i][j]);
+  EXPECT_EQ(0.0, m[n - 1][n - 1]);
+}
+
+TEST(TDynamicMatrix, large_copy_is_equal_to_source)
+{
+  const size_t n = 1201;
+  TDynamicMatrix<long long, TContiguousStorage<long long>> a(n, uninitialized);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      a[i][j] = (long long)(i * n + j);
+  TDynamicMatrix<long long, TContiguousStorage<long long>> b(a);
+
+  EXPECT_EQ(a, b);
+  b[n - 1][n - 1] = 0;
+  EXPECT_NE(a, b);
+}
+
+typedef TDynamicMatrix<int, TSharedStorage<int>> TSharedIntMatrix;
+
+TEST(TDynamicMatrix, shared_storage_copy_does_not_copy_elements)
+{
+  TSharedIntMatrix m(3);
+  m[1][2] = 5;
+  TSharedIntMatrix m1(m), m2(1);
+  m2 = m;
+  const TSharedIntMatrix& cm = m, & cm1 = m1, & cm2 = m2;
+
+  EXPECT_EQ(&cm[0][0], &cm1[0][0]);
+  EXPECT_EQ(&cm[0][0], &cm2[0][0]);
+  EXPECT_EQ(5, cm1[1][2]);
+  EXPECT_EQ(m, m2);
+}
+
+TEST(TDynamicMatrix, shared_storage_copies_on_first_write)
+{
+  TSharedIntMatrix m(3);
+  m[1][2] = 5;
+  TSharedIntMatrix m1(m);
+  m1[1][2] = 7;
+  m1.at(0, 0) = 1;
+  const TSharedIntMatrix& cm = m, & cm1 = m1;
+
+  EXPECT_NE(&cm[0][0], &cm1[0][0]);
+  EXPECT_EQ(5, cm[1][2]);
+  EXPECT_EQ(0, cm[0][0]);
+  EXPECT_EQ(7, cm1[1][2]);
+  EXPECT_EQ(1, cm1[0][0]);
+}
+
+TEST(TDynamicMatrix, shared_storage_arithmetic_does_not_change_copies)
+{
+  const size_t n = 70;
+  TDynamicMatrix<double, TSharedStorage<double>> a(n), b(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    a[i][i] = 2;
+    b[i][(i + 1) % n] = 1;
+  }
+  TDynamicMatrix<double, TSharedStorage<double>> a0(a), c(a), d(a);
+  c += b;
+  d = a * b + d;
+  a *= 3;
+
+  EXPECT_EQ(a0[5][5] * 3, a[5][5]);
+  EXPECT_EQ(2, a0[5][5]);
+  EXPECT_EQ(1, c[5][6]);
+  EXPECT_EQ(2, d[5][6]);
+  EXPECT_EQ(2, d[5][5]);
+  EXPECT_EQ(0, a0[5][6]);
+}
+
+TEST(TDynamicMatrix, can_create_rectangular_matrix)
+{
+  TDynamicMatrix<int> m(2, 5);
+  m[1][4] = 3;
+
+  EXPECT_EQ(2u, m.rows());
+  EXPECT_EQ(5u, m.cols());
+  EXPECT_EQ(3, m.at(1, 4));
+  ASSERT_ANY_THROW(m.at(4, 1));
+  ASSERT_ANY_THROW(TDynamicMatrix<int>(0, 5));
+}
+
+TEST(TDynamicMatrix, size_limits_apply_per_dimension)
+{
+  typedef TDynamicMatrix<double, TContiguousStorage<double>> M;
+
+  ASSERT_NO_THROW(M m(20 * MAX_MATRIX_SIZE, 8));
+  ASSERT_NO_THROW(M m(8, 20 * MAX_MATRIX_SIZE));
+  ASSERT_ANY_THROW(M m(MAX_MATRIX_SIZE + 1, MAX_MATRIX_SIZE));
+  ASSERT_ANY_THROW(M m(MAX_VECTOR_SIZE + 1, 1));
+}
+
+TEST(TDynamicMatrix, rectangular_matrices_with_not_equal_shape_cant_be_added)
+{
+  TDynamicMatrix<int> a(2, 3), b(3, 2), c(2, 3);
+
+  ASSERT_ANY_THROW(a + b);
+  ASSERT_ANY_THROW(a += b);
+  ASSERT_NO_THROW(a += c);
+  EXPECT_NE(a, b);
+}
+
+TEST(TDynamicMatrix, can_multiply_rectangular_matrices)
+{
+  // 3 x 5 * 5 x 2 - простой алгоритм, 130 x 70 * 70 x 90 - блочный
+  const size_t shapes[][3] = { { 3, 5, 2 }, { 130, 70, 90 } };
+  for (const size_t* s : shapes)
+  {
+    size_t m = s[0], k = s[1], n = s[2];
+    TDynamicMatrix<int, TContiguousStorage<int>> a(m, k), b(k, n);
+    for (size_t i = 0; i < m; i++)
+      for (size_t p = 0; p < k; p++)
+        a[i][p] = int((i * 3 + p) % 7) - 3;
+    for (size_t p = 0; p < k; p++)
+      for (size_t j = 0; j < n; j++)
+        b[p][j] = int((p + j * 5) % 11) - 5;
+    TDynamicMatrix<int, TContiguousStorage<int>> c = a * b;
+    TDynamicMatrix<int, TContiguousStorage<int>> at = transpose(a);
+
+    ASSERT_EQ(m, c.rows());
+    ASSERT_EQ(n, c.cols());
+    for (size_t i = 0; i < m; i++)
+      for (size_t j = 0; j < n; j++)
+      {
+        int sum = 0;
+        for (size_t p = 0; p < k; p++)
+          sum += a[i][p] * b[p][j];
+        ASSERT_EQ(sum, c[i][j]);
+      }
+    EXPECT_EQ(c, TDynamicMatrix<int>(transpose(at) * b));
+    EXPECT_EQ(TDynamicMatrix<int>(transpose(c)), TDynamicMatrix<int>(transpose(b) * at));
+  }
+}
+
+TEST(TDynamicMatrix, cant_multiply_matrices_with_not_matching_shapes)
+{
+  TDynamicMatrix<int> a(2, 3), b(2, 3);
+  TDynamicVector<int> x(2);
+
+  ASSERT_ANY_THROW(a * b);
+  ASSERT_NO_THROW(a * transpose(b));
+  ASSERT_ANY_THROW(a * x);
+  ASSERT_NO_THROW(transpose(a) * x);
+}
+
+TEST(TDynamicMatrix, can_multiply_rectangular_matrix_by_vector)
+{
+  TDynamicMatrix<int> a(2, 3);
+  TDynamicVector<int> x(3), y(2);
+  for (size_t j = 0; j < 3; j++)
+  {
+    x[j] = int(j + 1);
+    a[0][j] = 1;
+    a[1][j] = int(j);
+  }
+  y[0] = 1;
+  y[1] = 2;
+  TDynamicVector<int> ax = a * x, aty = transpose(a) * y;
+
+  EXPECT_EQ(2u, ax.size());
+  EXPECT_EQ(6, ax[0]);
+  EXPECT_EQ(8, ax[1]);
+  EXPECT_EQ(3u, aty.size());
+  EXPECT_EQ(1, aty[0]);
+  EXPECT_EQ(5, aty[2]);
+}
+
+TEST(TDynamicMatrix, can_transpose_rectangular_matrix_in_place)
+{
+  TDynamicMatrix<int> a(3, 40);
+  for (size_t i = 0; i < 3; i++)
+    for (size_t j = 0; j < 40; j++)
+      a[i][j] = int(i * 40 + j);
+  a = transpose(a);
+
+  EXPECT_EQ(40u, a.rows());
+  EXPECT_EQ(3u, a.cols());
+  EXPECT_EQ(41, a[1][1]);
+  EXPECT_EQ(119, a[39][2]);
+}
+
+TEST(TDynamicMatrix, can_output_rectangular_matrix)
+{
+  TDynamicMatrix<int> a(2, 3);
+  a[1][2] = 7;
+  std::ostringstream os;
+  os << a;
+
+  EXPECT_EQ("0 0 0 \n0 0 7 \n", os.str());
+}
+
+TEST(TDynamicMatrix, can_take_rectangular_submatrix)
+{
+  TDynamicMatrix<int, TContiguousStorage<int>> a(4, 6);
+  TDynamicMatrix<int> ones(2, 3);
+  for (size_t i = 0; i < 2; i++)
+    for (size_t j = 0; j < 3; j++)
+      ones[i][j] = 1;
+  a.submatrix(1, 2, 2, 3) += ones;
+  TDynamicMatrix<int> s = a.submatrix(0, 1, 3, 2);
+
+  EXPECT_EQ(1, a[2][4]);
+  EXPECT_EQ(0, a[2][5]);
+  EXPECT_EQ(3u, s.rows());
+  EXPECT_EQ(2u, s.cols());
+  EXPECT_EQ(1, s[1][1]);
+}
@@ -0,0 +1,88 @@
+#include "tmatrix.h"
+
+#include <gtest.h>
+#include <cstring>
+#include <vector>
+
+TEST(TSimd, detected_level_is_current_by_default)
+{
+  EXPECT_EQ(max_simd_level(), simd_level());
+}
+
+TEST(TSimd, can_get_level_name)
+{
+  EXPECT_STREQ("scalar", simd_level_name(SIMD_SCALAR));
+  EXPECT_STREQ("avx2", simd_level_name(SIMD_AVX2));
+  EXPECT_NE(nullptr, simd_level_name());
+}
+
+TEST(TSimd, cant_set_level_above_detected_one)
+{
+  set_simd_level(SIMD_AVX512);
+
+  EXPECT_EQ(max_simd_level(), simd_level());
+}
+
+template<typename T>
+void check_kernels_at_all_levels()
+{
+  const size_t n = 77;
+  std::vector<T> a(n), b(n), r(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    a[i] = T(int(i % 9) - 4);
+    b[i] = T(int(i % 4) + 1);
+  }
+  for (int l = SIMD_SCALAR; l <= max_simd_level(); l++)
+  {
+    set_simd_level(TSimdLevel(l));
+    T dot = T();
+    simd::sub(a.data(), b.data(), r.data(), n);
+    for (size_t i = 0; i < n; i++)
+    {
+      ASSERT_EQ(a[i] - b[i], r[i]) << simd_level_name();
+      dot += a[i] * b[i];
+    }
+    simd::mul_scalar(a.data(), T(5), r.data(), n);
+    for (size_t i = 0; i < n; i++)
+      ASSERT_EQ(a[i] * T(5), r[i]) << simd_level_name();
+    r = b;
+    simd::axpy(T(3), a.data(), r.data(), n);
+    for (size_t i = 0; i < n; i++)
+      ASSERT_EQ(T(3) * a[i] + b[i], r[i]) << simd_level_name();
+    ASSERT_EQ(dot, simd::dot(a.data(), b.data(), n)) << simd_level_name();
+    r = b;
+    ASSERT_EQ(dot, simd::dot_axpy(T(3), a.data(), b.data(), r.data(), n)) << simd_level_name();
+    for (size_t i = 0; i < n; i++)
+      ASSERT_EQ(T(3) * a[i] + b[i], r[i]) << simd_level_name();
+  }
+  set_simd_level(max_simd_level());
+}
+
+TEST(TSimd, kernels_give_same_results_at_all_levels)
+{
+  check_kernels_at_all_levels<float>();
+  check_kernels_at_all_levels<double>();
+  check_kernels_at_all_levels<int32_t>();
+  check_kernels_at_all_levels<int64_t>();
+}
+
+TEST(TSimd, gemm_gives_same_results_at_all_levels)
+{
+  const size_t n = 97;
+  TDynamicMatrix<float> a(n), b(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      a[i][j] = float(int((i + 2 * j) % 7) - 3);
+      b[i][j] = float(int((3 * i + j) % 5) - 2);
+    }
+  set_simd_level(SIMD_SCALAR);
+  TDynamicMatrix<float> expected = a * b;
+  for (int l = SIMD_SSE42; l <= max_simd_level(); l++)
+  {
+    set_simd_level(TSimdLevel(l));
+    ASSERT_EQ(expected, a * b) << simd_level_name();
+  }
+  set_simd_level(max_simd_level());
+}
@@ -0,0 +1,368 @@
+#include "tsparse.h"
+
+#include <gtest.h>
+#include <cmath>
+#include <limits>
+
+typedef TCsrMatrix<int> TCsrInt;
+
+// плотная матрица r x c, примерно каждый третий элемент ненулевой
+static TDynamicMatrix<int> make_dense(size_t r, size_t c)
+{
+  TDynamicMatrix<int> m(r, c);
+  for (size_t i = 0; i < r; i++)
+    for (size_t j = 0; j < c; j++)
+      if ((i * 7 + j * 5) % 3 == 0)
+        m[i][j] = int((i + 2 * j) % 9) - 4;
+  return m;
+}
+
+TEST(TCsrMatrix, can_create_matrix_with_positive_size)
+{
+  ASSERT_NO_THROW(TCsrInt m(5, 7));
+  ASSERT_ANY_THROW(TCsrInt m(0, 7));
+  ASSERT_ANY_THROW(TCsrInt m(MAX_VECTOR_SIZE + 1, 1));
+}
+
+TEST(TCsrMatrix, size_is_not_limited_by_max_matrix_size)
+{
+  TCsrInt m(size_t(MAX_MATRIX_SIZE) * 100, size_t(MAX_MATRIX_SIZE) * 100);
+
+  EXPECT_EQ(0u, m.nonzeros());
+  EXPECT_EQ(0, m.at(123456, 654321));
+}
+
+TEST(TCsrMatrix, triplets_are_sorted_and_duplicates_are_summed)
+{
+  std::vector<TTriplet<int>> items = { { 2, 3, 1 }, { 0, 1, 2 }, { 2, 0, 3 }, { 2, 3, 4 }, { 0, 0, 5 } };
+  TCsrInt m(3, 4, items);
+
+  EXPECT_EQ(4u, m.nonzeros());
+  EXPECT_EQ(5, m.at(0, 0));
+  EXPECT_EQ(2, m.at(0, 1));
+  EXPECT_EQ(3, m.at(2, 0));
+  EXPECT_EQ(5, m.at(2, 3));
+  EXPECT_EQ(0, m.at(1, 1));
+  const size_t ptr[] = { 0, 2, 2, 4 };
+  for (size_t i = 0; i < 4; i++)
+    EXPECT_EQ(ptr[i], m.row_ptr()[i]);
+  EXPECT_EQ(0u, m.col_index()[2]);
+  EXPECT_EQ(3u, m.col_index()[3]);
+}
+
+TEST(TCsrMatrix, throws_when_triplet_is_out_of_range)
+{
+  std::vector<TTriplet<int>> items = { { 0, 4, 1 } };
+
+  ASSERT_ANY_THROW(TCsrInt m(3, 4, items));
+}
+
+TEST(TCsrMatrix, converts_from_and_to_dense_matrix)
+{
+  TDynamicMatrix<int> d = make_dense(20, 300);
+  TCsrInt m(d);
+
+  EXPECT_LT(m.nonzeros(), size_t(20 * 300 / 2));
+  EXPECT_EQ(d, TDynamicMatrix<int>(m));
+  EXPECT_EQ(TDynamicMatrix<int>(d + d), TDynamicMatrix<int>(m + d));
+}
+
+TEST(TCsrMatrix, can_multiply_by_vector)
+{
+  // 30 x 40 - последовательно, 3000 x 1000 - по потокам
+  const size_t r[] = { 30, 3000 }, c[] = { 40, 1000 };
+  size_t old = get_num_threads();
+  set_num_threads(4);
+  for (size_t t = 0; t < 2; t++)
+  {
+    TDynamicMatrix<int> d = make_dense(r[t], c[t]);
+    TCsrInt m(d);
+    TDynamicVector<int> x(c[t]);
+    for (size_t j = 0; j < c[t]; j++)
+      x[j] = int(j % 5) - 2;
+
+    EXPECT_EQ(d * x, m * x);
+    EXPECT_EQ(d * (x + x), m * (x + x));
+  }
+  set_num_threads(old);
+  ASSERT_ANY_THROW(TCsrInt(3, 4) * TDynamicVector<int>(3));
+}
+
+TEST(TCsrMatrix, can_transpose)
+{
+  TDynamicMatrix<int> d = make_dense(17, 29);
+  TCsrInt t = transpose(TCsrInt(d));
+
+  EXPECT_EQ(29u, t.rows());
+  EXPECT_EQ(17u, t.cols());
+  EXPECT_EQ(TCsrInt(TDynamicMatrix<int>(transpose(d))), t);
+}
+
+TEST(TCsrMatrix, can_add_subtract_and_scale)
+{
+  TDynamicMatrix<int> a = make_dense(15, 25), b = make_dense(25, 15);
+  TDynamicMatrix<int> bt = transpose(b);
+  TCsrInt sa(a), sb(bt);
+
+  EXPECT_EQ(TDynamicMatrix<int>(a + bt), TDynamicMatrix<int>(sa + sb));
+  EXPECT_EQ(TDynamicMatrix<int>(a - bt), TDynamicMatrix<int>(sa - sb));
+  EXPECT_EQ(TDynamicMatrix<int>(a * 3), TDynamicMatrix<int>(3 * sa));
+  ASSERT_ANY_THROW(sa + TCsrInt(15, 24));
+}
+
+TEST(TCsrMatrix, can_multiply_sparse_matrices)
+{
+  // 12 x 9 * 9 x 14 - последовательно, 600 x 300 * 300 x 400 - по потокам
+  const size_t m[] = { 12, 600 }, k[] = { 9, 300 }, n[] = { 14, 400 };
+  size_t old = get_num_threads();
+  set_num_threads(4);
+  for (size_t t = 0; t < 2; t++)
+  {
+    TDynamicMatrix<int> a = make_dense(m[t], k[t]), b = make_dense(k[t], n[t]);
+    TCsrInt c = TCsrInt(a) * TCsrInt(b);
+
+    EXPECT_EQ(TDynamicMatrix<int>(a * b), TDynamicMatrix<int>(c));
+    EXPECT_EQ(c.nonzeros(), c.row_ptr()[c.rows()]);
+    for (size_t i = 0; i < c.rows(); i++)
+      for (size_t p = c.row_ptr()[i] + 1; p < c.row_ptr()[i + 1]; p++)
+        ASSERT_LT(c.col_index()[p - 1], c.col_index()[p]);
+  }
+  set_num_threads(old);
+  ASSERT_ANY_THROW(TCsrInt(3, 4) * TCsrInt(3, 4));
+}
+
+TEST(TCsrMatrix, square_of_path_graph_adjacency_matrix)
+{
+  // A^2(i, j) - число путей длины 2 из i в j
+  const size_t n = 100000;
+  std::vector<TTriplet<int>> items;
+  for (size_t i = 0; i + 1 < n; i++)
+  {
+    items.push_back({ i, i + 1, 1 });
+    items.push_back({ i + 1, i, 1 });
+  }
+  TCsrInt a(n, n, items);
+  TCsrInt a2 = a * a;
+
+  EXPECT_EQ(3 * n - 4, a2.nonzeros());
+  EXPECT_EQ(1, a2.at(0, 0));
+  EXPECT_EQ(2, a2.at(5, 5));
+  EXPECT_EQ(1, a2.at(5, 7));
+  EXPECT_EQ(0, a2.at(5, 6));
+}
+
+TEST(TCsrMatrix, handles_million_rows)
+{
+  // трехдиагональная матрица 10^6 x 10^6: в плотном виде не помещается
+  const size_t n = 1000000;
+  std::vector<TTriplet<double>> items;
+  for (size_t i = 0; i < n; i++)
+  {
+    items.push_back({ i, i, 2.0 });
+    if (i > 0)
+      items.push_back({ i, i - 1, -1.0 });
+    if (i + 1 < n)
+      items.push_back({ i, i + 1, -1.0 });
+  }
+  TCsrMatrix<double> m(n, n, items);
+  TDynamicVector<double> x(n);
+  for (size_t i = 0; i < n; i++)
+    x[i] = double(i);
+  TDynamicVector<double> y = m * x;
+
+  EXPECT_EQ(3 * n - 2, m.nonzeros());
+  EXPECT_EQ(-1.0, y[0]);
+  EXPECT_EQ(0.0, y[n / 2]);
+  EXPECT_EQ(double(n), y[n - 1]);
+  EXPECT_EQ(m, transpose(m));
+}
+
+// n x n с сильно различающимися длинами строк: каждая десятая строка длинная
+template<typename T>
+static TCsrMatrix<T> make_irregular(size_t n)
+{
+  std::vector<TTriplet<T>> items;
+  for (size_t i = 0; i < n; i++)
+  {
+    size_t len = i % 10 == 0 ? 40 + i % 13 : i % 4;
+    for (size_t k = 0; k < len; k++)
+      items.push_back({ i, (i * 31 + k * 17) % n, T(int(k % 7) - 3) });
+  }
+  return TCsrMatrix<T>(n, n, items);
+}
+
+template<typename T>
+static void check_sell_product(size_t n, size_t sigma)
+{
+  TCsrMatrix<T> a = make_irregular<T>(n);
+  TSellMatrix<T> s(a, sigma);
+  TDynamicVector<T> x(n);
+  for (size_t j = 0; j < n; j++)
+    x[j] = T(int(j % 5) - 2);
+  TDynamicVector<T> y = a * x;
+
+  for (int l = SIMD_SCALAR; l <= max_simd_level(); l++)
+  {
+    set_simd_level(TSimdLevel(l));
+    ASSERT_EQ(y, s * x) << simd_level_name();
+  }
+  set_simd_level(max_simd_level());
+}
+
+TEST(TSellMatrix, product_matches_csr_product)
+{
+  // число строк не кратно SELL_CHUNK, окна разной ширины
+  const size_t sigmas[] = { 1, 3, SELL_SIGMA };
+  for (size_t sigma : sigmas)
+  {
+    check_sell_product<double>(203, sigma);
+    check_sell_product<float>(203, sigma);
+    check_sell_product<int>(203, sigma);
+  }
+}
+
+// строка 1 содержит единственный элемент в столбце 3, где x(3) = Inf,
+// и при sigma = 1 дополняется до длины строки 0 в той же порции
+template<typename T>
+static void check_sell_product_with_infinity(size_t sigma)
+{
+  const size_t n = 203;
+  std::vector<TTriplet<T>> items;
+  for (size_t i = 0; i < n; i++)
+  {
+    size_t len = i == 1 ? 0 : i % 10 == 0 ? 40 + i % 13 : i % 4;
+    for (size_t k = 0; k < len; k++)
+      items.push_back({ i, (i * 31 + k * 17) % n, T(int(k % 7) - 3) });
+  }
+  items.push_back({ 1, 3, T(2) });
+  TCsrMatrix<T> a(n, n, items);
+  TSellMatrix<T> s(a, sigma);
+  TDynamicVector<T> x(n);
+  for (size_t j = 0; j < n; j++)
+    x[j] = T(int(j % 5) - 2);
+  x[3] = std::numeric_limits<T>::infinity();
+  TDynamicVector<T> y = a * x;
+  ASSERT_EQ(std::numeric_limits<T>::infinity(), y[1]);
+
+  for (int l = SIMD_SCALAR; l <= max_simd_level(); l++)
+  {
+    set_simd_level(TSimdLevel(l));
+    TDynamicVector<T> r = s * x;
+    for (size_t i = 0; i < n; i++)
+    {
+      ASSERT_EQ(std::isnan(y[i]), std::isnan(r[i])) << simd_level_name() << " row " << i;
+      if (!std::isnan(y[i]))
+        ASSERT_EQ(y[i], r[i]) << simd_level_name() << " row " << i;
+    }
+  }
+  set_simd_level(max_simd_level());
+}
+
+TEST(TSellMatrix, padding_does_not_spread_infinity)
+{
+  check_sell_product_with_infinity<double>(1);
+  check_sell_product_with_infinity<double>(SELL_SIGMA);
+  check_sell_product_with_infinity<float>(1);
+  check_sell_product_with_infinity<float>(SELL_SIGMA);
+}
+
+TEST(TSellMatrix, sorting_reduces_padding)
+{
+  TCsrMatrix<double> a = make_irregular<double>(1000);
+  TSellMatrix<double> ell(a, 1), sell(a, SELL_SIGMA);
+
+  EXPECT_GE(sell.stored(), a.nonzeros());
+  EXPECT_LT(sell.stored(), ell.stored());
+  EXPECT_EQ(0u, sell.stored() % SELL_CHUNK);
+}
+
+TEST(TSellMatrix, product_is_computed_in_parallel)
+{
+  size_t old = get_num_threads();
+  set_num_threads(4);
+  check_sell_product<double>(20000, SELL_SIGMA);
+  set_num_threads(old);
+}
+
+TEST(TSellMatrix, throws_on_bad_arguments)
+{
+  TCsrMatrix<double> a = make_irregular<double>(50);
+
+  ASSERT_ANY_THROW(TSellMatrix<double>(a, 0));
+  ASSERT_ANY_THROW(TSellMatrix<double>(a) * TDynamicVector<double>(49));
+}
+
+// матрица из блоков B x B на блочных диагоналях 0, +-1 и +-5,
+// в блоке (0, 0) хранится только один элемент
+template<typename T, size_t B>
+static TCsrMatrix<T> make_blocked(size_t nb)
+{
+  std::vector<TTriplet<T>> items;
+  for (size_t bi = 0; bi < nb; bi++)
+    for (size_t bj = 0; bj < nb; bj++)
+    {
+      size_t d = bi > bj ? bi - bj : bj - bi;
+      if (d > 1 && d != 5)
+        continue;
+      for (size_t r = 0; r < B; r++)
+        for (size_t c = 0; c < B; c++)
+          if (bi + bj > 0 || r + c == 0)
+            items.push_back({ bi * B + r, bj * B + c, T(int((bi + r * 3 + c) % 7) - 3) });
+    }
+  return TCsrMatrix<T>(nb * B, nb * B, items);
+}
+
+template<typename T, size_t B>
+static void check_bsr_product(size_t nb)
+{
+  TCsrMatrix<T> a = make_blocked<T, B>(nb);
+  TBsrMatrix<T, B> m(a);
+  TDynamicVector<T> x(nb * B);
+  for (size_t j = 0; j < nb * B; j++)
+    x[j] = T(int(j % 5) - 2);
+
+  EXPECT_EQ(a * x, m * x);
+}
+
+TEST(TBsrMatrix, converts_from_csr_matrix)
+{
+  TCsrMatrix<int> a = make_blocked<int, 3>(12);
+  TBsrMatrix<int, 3> m(a);
+
+  EXPECT_EQ(12u + 2 * 11 + 2 * 7, m.nonzero_blocks());
+  EXPECT_EQ(TDynamicMatrix<int>(a), TDynamicMatrix<int>(m));
+  EXPECT_EQ(a.at(0, 0), m.at(0, 0));
+  EXPECT_EQ(0, m.at(1, 2));
+  EXPECT_EQ(a.at(17, 16), m.at(17, 16));
+  ASSERT_ANY_THROW(m.at(36, 0));
+}
+
+TEST(TBsrMatrix, stores_one_column_index_per_block)
+{
+  TCsrMatrix<double> a = make_blocked<double, 4>(100);
+  TBsrMatrix<double, 4> m(a);
+
+  EXPECT_EQ(m.nonzero_blocks() * 16, a.nonzeros() + 15);
+  EXPECT_EQ(m.nonzero_blocks(), m.block_ptr()[m.rows() / 4]);
+}
+
+TEST(TBsrMatrix, product_matches_csr_product)
+{
+  check_bsr_product<int, 1>(30);
+  check_bsr_product<int, 3>(30);
+  check_bsr_product<double, 3>(30);
+  check_bsr_product<double, 4>(30);
+  // по потокам
+  size_t old = get_num_threads();
+  set_num_threads(4);
+  check_bsr_product<double, 3>(3000);
+  set_num_threads(old);
+}
+
+TEST(TBsrMatrix, throws_on_bad_sizes)
+{
+  TCsrMatrix<double> a(10, 12);
+
+  ASSERT_ANY_THROW((TBsrMatrix<double, 3>(a)));
+  ASSERT_ANY_THROW((TBsrMatrix<double, 2>(a) * TDynamicVector<double>(10)));
+}
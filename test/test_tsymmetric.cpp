@@ -0,0 +1,142 @@
+#include "tsymmetric.h"
+
+#include <sstream>
+#include <gtest.h>
+
+typedef TSymmetricMatrix<int> TSymInt;
+
+// симметричная матрица с элементами (i + j) % 7 - 3
+static TSymInt make_symmetric(size_t n)
+{
+  TSymInt m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = i; j < n; j++)
+      m[i][j] = int((i + j) % 7) - 3;
+  return m;
+}
+
+// прямоугольная матрица n x k с небольшими целыми элементами
+static TDynamicMatrix<int> make_rect(size_t n, size_t k)
+{
+  TDynamicMatrix<int> a(n, k);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < k; j++)
+      a[i][j] = int((i * 5 + j * 3) % 9) - 4;
+  return a;
+}
+
+TEST(TSymmetricMatrix, can_create_matrix_with_positive_length)
+{
+  ASSERT_NO_THROW(TSymInt m(5));
+  ASSERT_ANY_THROW(TSymInt m(0));
+  ASSERT_ANY_THROW(TSymInt m(MAX_MATRIX_SIZE + 1));
+}
+
+TEST(TSymmetricMatrix, mirrored_elements_are_the_same_element)
+{
+  TSymInt m(4);
+  m.at(3, 1) = 5;
+
+  EXPECT_EQ(5, m.at(1, 3));
+  EXPECT_EQ(5, m[1][3]);
+  EXPECT_EQ(5, m(3, 1));
+  ASSERT_ANY_THROW(m.at(4, 0));
+}
+
+TEST(TSymmetricMatrix, converts_to_dense_symmetric_matrix)
+{
+  const size_t n = 40;
+  TSymInt m = make_symmetric(n);
+  TDynamicMatrix<int> d = m;
+
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      EXPECT_EQ(int((i + j) % 7) - 3, d[i][j]);
+  EXPECT_EQ(m, TSymInt(d));
+}
+
+TEST(TSymmetricMatrix, can_add_subtract_and_scale)
+{
+  TSymInt a = make_symmetric(5), b = make_symmetric(5);
+  TDynamicMatrix<int> d = a;
+
+  EXPECT_EQ(TDynamicMatrix<int>(d + d), TDynamicMatrix<int>(a + b));
+  EXPECT_EQ(TSymInt(5), a - b);
+  EXPECT_EQ(TDynamicMatrix<int>(d * 3), TDynamicMatrix<int>(3 * a));
+  ASSERT_ANY_THROW(a + TSymInt(4));
+}
+
+TEST(TSymmetricMatrix, can_multiply_by_vector)
+{
+  const size_t n = 50;
+  TSymInt a = make_symmetric(n);
+  TDynamicVector<int> x(n);
+  for (size_t i = 0; i < n; i++)
+    x[i] = int(i % 3) - 1;
+  TDynamicMatrix<int> d = a;
+
+  EXPECT_EQ(d * x, a * x);
+  EXPECT_EQ(d * (x + x), a * (x + x));
+  ASSERT_ANY_THROW(a * TDynamicVector<int>(n + 1));
+}
+
+TEST(TSymmetricMatrix, multiply_by_vector_gives_same_results_at_all_levels)
+{
+  const size_t n = 133;
+  TSymmetricMatrix<double> a(n);
+  TDynamicVector<double> x(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    x[i] = double(int(i % 5) - 2);
+    for (size_t j = i; j < n; j++)
+      a[i][j] = double(int((i + 2 * j) % 7) - 3);
+  }
+  TDynamicMatrix<double> d = a;
+  TDynamicVector<double> expected = d * x;
+  for (int l = SIMD_SCALAR; l <= max_simd_level(); l++)
+  {
+    set_simd_level(TSimdLevel(l));
+    ASSERT_EQ(expected, a * x) << simd_level_name();
+  }
+  set_simd_level(max_simd_level());
+}
+
+TEST(TSymmetricMatrix, syrk_matches_dense_product)
+{
+  // 5 x 3 - построчно, 300 x 70 - по плиткам, последняя неполная
+  const size_t n[] = { 5, 300 }, k[] = { 3, 70 };
+  for (size_t t = 0; t < 2; t++)
+  {
+    TDynamicMatrix<int> a = make_rect(n[t], k[t]);
+    TDynamicMatrix<int> g = a * transpose(a);
+
+    EXPECT_EQ(TSymInt(g), syrk(a));
+  }
+}
+
+TEST(TSymmetricMatrix, syrk_updates_existing_matrix)
+{
+  const size_t sizes[] = { 6, 260 };
+  for (size_t n : sizes)
+  {
+    TDynamicMatrix<int> a = make_rect(n, 80);
+    TSymInt c = make_symmetric(n);
+    TDynamicMatrix<int> expected = 2 * (a * transpose(a)) + TDynamicMatrix<int>(c) * 3;
+
+    syrk(2, a, 3, c);
+    EXPECT_EQ(TSymInt(expected), c);
+  }
+  TSymInt c(4);
+  ASSERT_ANY_THROW(syrk(1, make_rect(5, 2), 0, c));
+}
+
+TEST(TSymmetricMatrix, input_reads_stored_elements_and_output_prints_matrix)
+{
+  TSymInt a(2);
+  std::istringstream is("1 2 3");
+  is >> a;
+  std::ostringstream os;
+  os << a;
+
+  EXPECT_EQ("1 2 \n2 3 \n", os.str());
+}
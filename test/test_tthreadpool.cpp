@@ -0,0 +1,115 @@
+#include "tthreadpool.h"
+#include "tgemm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <gtest.h>
+
+TEST(TThreadPool, can_create_pool)
+{
+  ASSERT_NO_THROW(TThreadPool pool(4));
+}
+
+TEST(TThreadPool, can_get_size)
+{
+  TThreadPool pool(3);
+
+  EXPECT_EQ(3u, pool.size());
+}
+
+TEST(TThreadPool, parallel_for_visits_each_index_once)
+{
+  TThreadPool pool(4);
+  std::vector<int> hits(1000);
+
+  pool.parallel_for(hits.size(), [&](size_t i) { hits[i]++; });
+
+  for (size_t i = 0; i < hits.size(); i++)
+    ASSERT_EQ(1, hits[i]);
+}
+
+TEST(TThreadPool, can_be_reused_between_calls)
+{
+  TThreadPool pool(4);
+  std::atomic<int> sum(0);
+
+  for (int r = 0; r < 50; r++)
+    pool.parallel_for(10, [&](size_t i) { sum += int(i); });
+
+  EXPECT_EQ(50 * 45, sum);
+}
+
+TEST(TThreadPool, can_resize_pool)
+{
+  TThreadPool pool(2);
+  pool.resize(5);
+  std::atomic<int> cnt(0);
+  pool.parallel_for(100, [&](size_t) { cnt++; });
+
+  EXPECT_EQ(5u, pool.size());
+  EXPECT_EQ(100, cnt);
+}
+
+TEST(TThreadPool, nested_parallel_for_runs_serially)
+{
+  TThreadPool pool(4);
+  std::atomic<int> cnt(0);
+
+  pool.parallel_for(8, [&](size_t) { pool.parallel_for(8, [&](size_t) { cnt++; }); });
+
+  EXPECT_EQ(64, cnt);
+}
+
+TEST(TThreadPool, exception_from_job_is_passed_to_caller)
+{
+  TThreadPool pool(4);
+  std::atomic<int> cnt(0);
+
+  // исключение и в рабочем потоке, и в вызывающем
+  for (size_t bad = 0; bad < 100; bad += 33)
+    ASSERT_THROW(pool.parallel_for(100, [&](size_t i)
+    {
+      if (i == bad)
+        throw std::runtime_error("job failed");
+    }), std::runtime_error);
+  // пул остается рабочим и по-прежнему распределяет итерации по потокам
+  std::vector<std::thread::id> ids(400);
+  pool.parallel_for(ids.size(), [&](size_t i)
+  {
+    cnt++;
+    ids[i] = std::this_thread::get_id();
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  });
+  std::sort(ids.begin(), ids.end());
+
+  EXPECT_EQ(400, cnt);
+  EXPECT_GT(std::unique(ids.begin(), ids.end()) - ids.begin(), 1);
+}
+
+TEST(TThreadPool, can_set_number_of_library_threads)
+{
+  size_t old = get_num_threads();
+  set_num_threads(3);
+
+  EXPECT_EQ(3u, get_num_threads());
+  set_num_threads(old);
+}
+
+TEST(TThreadPool, parallel_gemm_matches_serial_one)
+{
+  const size_t m = 150, n = 170, k = 130;
+  std::vector<double> a(m * k), b(k * n), c1(m * n), c2(m * n);
+  for (size_t i = 0; i < a.size(); i++)
+    a[i] = double(i % 17) - 8;
+  for (size_t i = 0; i < b.size(); i++)
+    b[i] = double(i % 13) / 2;
+  TThreadPool pool(4);
+
+  gemm(m, n, k, 1.0, [&](size_t i) { return &a[i * k]; }, [&](size_t i) { return &b[i * n]; },
+    0.0, [&](size_t i) { return &c1[i * n]; });
+  gemm_parallel(m, n, k, 1.0, [&](size_t i) { return &a[i * k]; }, [&](size_t i) { return &b[i * n]; },
+    0.0, [&](size_t i) { return &c2[i * n]; }, pool);
+
+  EXPECT_EQ(c1, c2);
+}
@@ -0,0 +1,221 @@
+#include "ttriangular.h"
+
+#include <cmath>
+#include <sstream>
+#include <gtest.h>
+
+typedef TUpperTriangularMatrix<int> TUpperInt;
+
+// верхняя треугольная матрица с элементами (i + 1) * 10 + j - i
+static TUpperInt make_upper(size_t n)
+{
+  TUpperInt m(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = i; j < n; j++)
+      m[i][j] = int((i + 1) * 10 + j - i);
+  return m;
+}
+
+TEST(TUpperTriangularMatrix, can_create_matrix_with_positive_length)
+{
+  ASSERT_NO_THROW(TUpperInt m(5));
+  ASSERT_ANY_THROW(TUpperInt m(0));
+  ASSERT_ANY_THROW(TUpperInt m(MAX_MATRIX_SIZE + 1));
+}
+
+TEST(TUpperTriangularMatrix, elements_below_diagonal_are_zero)
+{
+  TUpperInt m = make_upper(4);
+  const TUpperInt& cm = m;
+
+  EXPECT_EQ(0, m(3, 0));
+  EXPECT_EQ(0, cm.at(2, 1));
+  EXPECT_EQ(22, cm.at(1, 3));
+  ASSERT_ANY_THROW(m.at(2, 1));
+  ASSERT_ANY_THROW(m.at(0, 4));
+}
+
+TEST(TUpperTriangularMatrix, converts_to_dense_matrix)
+{
+  const size_t n = 300;
+  TUpperInt m = make_upper(n);
+  TDynamicMatrix<int> d = m;
+
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+      ASSERT_EQ(m(i, j), d[i][j]);
+  EXPECT_EQ(m, TUpperInt(d));
+}
+
+TEST(TUpperTriangularMatrix, can_add_and_subtract_matrices)
+{
+  TUpperInt a = make_upper(5), b = make_upper(5);
+  TUpperInt c = a + b;
+  TUpperInt d = c - a;
+
+  EXPECT_EQ(2 * a(1, 4), c(1, 4));
+  EXPECT_EQ(b, d);
+  EXPECT_EQ(a * 2, c);
+  ASSERT_ANY_THROW(a + TUpperInt(4));
+}
+
+TEST(TUpperTriangularMatrix, product_matches_dense_product)
+{
+  // 40 - построчно, 300 - по блокам, последний блок неполный
+  const size_t sizes[] = { 40, 300 };
+  for (size_t n : sizes)
+  {
+    TUpperInt a = make_upper(n), b(n);
+    for (size_t i = 0; i < n; i++)
+      for (size_t j = i; j < n; j++)
+        b[i][j] = int((i + 2 * j) % 5) - 2;
+    TDynamicMatrix<int> da = a, db = b;
+    TDynamicMatrix<int> dc = da * db;
+
+    EXPECT_EQ(TUpperInt(dc), a * b);
+    EXPECT_EQ(dc, TDynamicMatrix<int>(a * b));
+  }
+}
+
+TEST(TUpperTriangularMatrix, can_multiply_by_vector)
+{
+  const size_t n = 50;
+  TUpperInt a = make_upper(n);
+  TDynamicVector<int> x(n);
+  for (size_t i = 0; i < n; i++)
+    x[i] = int(i % 3) - 1;
+  TDynamicMatrix<int> d = a;
+
+  EXPECT_EQ(d * x, a * x);
+  EXPECT_EQ(d * (x + x), a * (x + x));
+  ASSERT_ANY_THROW(a * TDynamicVector<int>(n + 1));
+}
+
+TEST(TUpperTriangularMatrix, can_be_used_in_dense_expressions)
+{
+  TUpperInt a = make_upper(3);
+  TDynamicMatrix<int> d(3);
+  d[2][0] = 1;
+  TDynamicMatrix<int> s = d + a;
+
+  EXPECT_EQ(1, s[2][0]);
+  EXPECT_EQ(12, s[0][2]);
+}
+
+TEST(TUpperTriangularMatrix, input_reads_stored_elements_and_output_prints_matrix)
+{
+  TUpperInt a(2);
+  std::istringstream is("1 2 3");
+  is >> a;
+  std::ostringstream os;
+  os << a;
+
+  EXPECT_EQ("1 2 \n0 3 \n", os.str());
+}
+
+// треугольная матрица системы с единицами на диагонали: решение целочисленное;
+// в другой половине - мусор, который не должен читаться
+static TDynamicMatrix<int> make_system(size_t n, TTriangle uplo, TDynamicMatrix<int>& exact)
+{
+  TDynamicMatrix<int> t(n);
+  exact = TDynamicMatrix<int>(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      bool stored = uplo == TTriangle::lower ? j < i : j > i;
+      int v = i == j ? 1 : stored ? int((i + 2 * j) % 3) - 1 : 0;
+      exact[i][j] = v;
+      t[i][j] = i == j || stored ? v : 7;
+    }
+  return t;
+}
+
+TEST(TriangularSolve, solves_system_with_vector)
+{
+  const size_t n = 40;
+  const TTriangle forms[] = { TTriangle::lower, TTriangle::upper };
+  for (TTriangle uplo : forms)
+  {
+    TDynamicMatrix<int> exact;
+    TDynamicMatrix<int> t = make_system(n, uplo, exact);
+    TDynamicVector<int> x(n);
+    for (size_t i = 0; i < n; i++)
+      x[i] = int(i % 5) - 2;
+
+    EXPECT_EQ(x, solve_triangular(t, uplo, exact * x));
+  }
+}
+
+TEST(TriangularSolve, solves_system_with_many_right_hand_sides)
+{
+  // 5 - один блок, 150 - несколько блоков, последний неполный
+  const size_t sizes[] = { 5, 150 };
+  const TTriangle forms[] = { TTriangle::lower, TTriangle::upper };
+  for (size_t n : sizes)
+    for (TTriangle uplo : forms)
+    {
+      TDynamicMatrix<int> exact;
+      TDynamicMatrix<int> t = make_system(n, uplo, exact);
+      TDynamicMatrix<int> x(n, 70);
+      for (size_t i = 0; i < n; i++)
+        for (size_t j = 0; j < 70; j++)
+          x[i][j] = int((i * 3 + j) % 7) - 3;
+      TDynamicMatrix<int> b = exact * x;
+
+      EXPECT_EQ(x, solve_triangular(t, uplo, b));
+    }
+}
+
+TEST(TriangularSolve, residual_is_small_for_double)
+{
+  const size_t n = 200;
+  TDynamicMatrix<double> t(n), b(n, 30);
+  for (size_t i = 0; i < n; i++)
+  {
+    for (size_t j = 0; j <= i; j++)
+      t[i][j] = 1.0 / (1 + i + j);
+    t[i][i] += 2;
+    for (size_t j = 0; j < 30; j++)
+      b[i][j] = double(i) - double(j);
+  }
+  TDynamicMatrix<double> x = solve_triangular(t, TTriangle::lower, b);
+  TDynamicMatrix<double> r = t * x - b;
+
+  double err = 0;
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < 30; j++)
+      err = std::max(err, std::abs(r[i][j]));
+  EXPECT_LT(err, 1e-9);
+}
+
+TEST(TriangularSolve, solves_system_with_packed_upper_matrix)
+{
+  const size_t n = 100;
+  TDynamicMatrix<int> exact;
+  TDynamicMatrix<int> t = make_system(n, TTriangle::upper, exact);
+  TUpperInt p(exact);
+  TDynamicVector<int> x(n);
+  TDynamicMatrix<int> xm(n, 3);
+  for (size_t i = 0; i < n; i++)
+  {
+    x[i] = int(i % 5) - 2;
+    for (size_t j = 0; j < 3; j++)
+      xm[i][j] = int(i + j) % 4;
+  }
+
+  EXPECT_EQ(x, solve_triangular(p, p * x));
+  EXPECT_EQ(xm, solve_triangular(p, TDynamicMatrix<int>(exact * xm)));
+}
+
+TEST(TriangularSolve, throws_when_sizes_do_not_match_or_matrix_is_singular)
+{
+  TDynamicMatrix<double> t(3), r(3, 4);
+  t[0][0] = t[1][1] = t[2][2] = 1;
+
+  ASSERT_ANY_THROW(solve_triangular(r, TTriangle::lower, TDynamicVector<double>(3)));
+  ASSERT_ANY_THROW(solve_triangular(t, TTriangle::lower, TDynamicVector<double>(4)));
+  ASSERT_ANY_THROW(solve_triangular(t, TTriangle::upper, TDynamicMatrix<double>(4, 2)));
+  t[1][1] = 0;
+  ASSERT_ANY_THROW(solve_triangular(t, TTriangle::upper, TDynamicVector<double>(3)));
+  ASSERT_ANY_THROW(solve_triangular(t, TTriangle::upper, TDynamicMatrix<double>(3, 2)));
+}
@@ -26,116 +26,466 @@ TEST(TDynamicVector, can_create_copied_vector)
 
 TEST(TDynamicVector, copied_vector_is_equal_to_source_one)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(10);
+  for (size_t i = 0; i < v.size(); i++)
+    v[i] = i;
+  TDynamicVector<int> v1(v);
+
+  EXPECT_EQ(v, v1);
 }
 
 TEST(TDynamicVector, copied_vector_has_its_own_memory)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(10);
+  TDynamicVector<int> v1(v);
+  v1[0] = 5;
+
+  EXPECT_EQ(0, v[0]);
+  EXPECT_NE(&v[0], &v1[0]);
 }
 
 TEST(TDynamicVector, can_get_size)
 {
   TDynamicVector<int> v(4);
 
-  EXPECT_EQ(4, v.size());
+  EXPECT_EQ(4u, v.size());
 }
 
-//TEST(TDynamicVector, can_set_and_get_element)
-//{
-//  TDynamicVector<int> v(4);
-//  v[0] = 4;
-//
-//  EXPECT_EQ(4, v[0]);
-//}
+TEST(TDynamicVector, can_set_and_get_element)
+{
+  TDynamicVector<int> v(4);
+  v[0] = 4;
+
+  EXPECT_EQ(4, v[0]);
+}
 
 TEST(TDynamicVector, throws_when_set_element_with_negative_index)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(4);
+
+  ASSERT_ANY_THROW(v.at(-1) = 1);
 }
 
 TEST(TDynamicVector, throws_when_set_element_with_too_large_index)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(4);
+
+  ASSERT_ANY_THROW(v.at(4) = 1);
 }
 
 TEST(TDynamicVector, can_assign_vector_to_itself)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(4);
+  v[1] = 3;
+  v = v;
+
+  EXPECT_EQ(3, v[1]);
 }
 
 TEST(TDynamicVector, can_assign_vectors_of_equal_size)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(4), v1(4);
+  v[2] = 7;
+  v1 = v;
+
+  EXPECT_EQ(v, v1);
 }
 
 TEST(TDynamicVector, assign_operator_change_vector_size)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(4), v1(2);
+  v1 = v;
+
+  EXPECT_EQ(4u, v1.size());
 }
 
 TEST(TDynamicVector, can_assign_vectors_of_different_size)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(4), v1(2);
+  v[3] = 1;
+  v1 = v;
+
+  EXPECT_EQ(v, v1);
 }
 
 TEST(TDynamicVector, compare_equal_vectors_return_true)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(4), v1(4);
+  v[0] = v1[0] = 2;
+
+  EXPECT_TRUE(v == v1);
 }
 
 TEST(TDynamicVector, compare_vector_with_itself_return_true)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(4);
+
+  EXPECT_TRUE(v == v);
 }
 
 TEST(TDynamicVector, vectors_with_different_size_are_not_equal)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(4), v1(5);
+
+  EXPECT_NE(v, v1);
 }
 
 TEST(TDynamicVector, can_add_scalar_to_vector)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(3);
+  v[1] = 1;
+  TDynamicVector<int> res = v + 2;
+
+  EXPECT_EQ(2, res[0]);
+  EXPECT_EQ(3, res[1]);
 }
 
 TEST(TDynamicVector, can_subtract_scalar_from_vector)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(3);
+  v[1] = 1;
+  TDynamicVector<int> res = v - 2;
+
+  EXPECT_EQ(-2, res[0]);
+  EXPECT_EQ(-1, res[1]);
 }
 
 TEST(TDynamicVector, can_multiply_scalar_by_vector)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(3);
+  v[1] = 4;
+  TDynamicVector<int> res = v * 3;
+
+  EXPECT_EQ(0, res[0]);
+  EXPECT_EQ(12, res[1]);
 }
 
 TEST(TDynamicVector, can_add_vectors_with_equal_size)
 {
-  ADD_FAILURE();
+  int a[] = { 1, 2, 3 }, b[] = { 4, 5, 6 }, c[] = { 5, 7, 9 };
+  TDynamicVector<int> v(a, 3), v1(b, 3), expected(c, 3);
+
+  EXPECT_EQ(expected, v + v1);
 }
 
 TEST(TDynamicVector, cant_add_vectors_with_not_equal_size)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(3), v1(4);
+
+  ASSERT_ANY_THROW(v + v1);
 }
 
 TEST(TDynamicVector, can_subtract_vectors_with_equal_size)
 {
-  ADD_FAILURE();
+  int a[] = { 1, 2, 3 }, b[] = { 4, 5, 6 }, c[] = { -3, -3, -3 };
+  TDynamicVector<int> v(a, 3), v1(b, 3), expected(c, 3);
+
+  EXPECT_EQ(expected, v - v1);
 }
 
 TEST(TDynamicVector, cant_subtract_vectors_with_not_equal_size)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(3), v1(4);
+
+  ASSERT_ANY_THROW(v - v1);
 }
 
 TEST(TDynamicVector, can_multiply_vectors_with_equal_size)
 {
-  ADD_FAILURE();
+  int a[] = { 1, 2, 3 }, b[] = { 4, 5, 6 };
+  TDynamicVector<int> v(a, 3), v1(b, 3);
+
+  EXPECT_EQ(32, v * v1);
 }
 
 TEST(TDynamicVector, cant_multiply_vectors_with_not_equal_size)
 {
-  ADD_FAILURE();
+  TDynamicVector<int> v(3), v1(4);
+
+  ASSERT_ANY_THROW(v * v1);
+}
+
+template<typename T>
+void check_vector_kernels(size_t n)
+{
+  TDynamicVector<T> a(n), b(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    a[i] = T(int(i % 7) - 3);
+    b[i] = T(int(i % 5) + 1);
+  }
+  TDynamicVector<T> sum = a + b, diff = a - b, scaled = a * T(3), shifted = a + T(2);
+  T dot = T();
+  for (size_t i = 0; i < n; i++)
+  {
+    ASSERT_EQ(a[i] + b[i], sum[i]);
+    ASSERT_EQ(a[i] - b[i], diff[i]);
+    ASSERT_EQ(a[i] * T(3), scaled[i]);
+    ASSERT_EQ(a[i] + T(2), shifted[i]);
+    dot += a[i] * b[i];
+  }
+  EXPECT_EQ(dot, a * b);
+}
+
+TEST(TDynamicVector, vector_kernels_handle_tail_elements)
+{
+  for (size_t n = 1; n < 70; n++)
+  {
+    check_vector_kernels<float>(n);
+    check_vector_kernels<double>(n);
+    check_vector_kernels<int32_t>(n);
+    check_vector_kernels<int64_t>(n);
+  }
+}
+
+TEST(TDynamicVector, integer_dot_product_is_exact)
+{
+  const size_t n = 1001;
+  TDynamicVector<int64_t> a(n), b(n);
+  int64_t expected = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    a[i] = int64_t(i) * 3000000007LL;
+    b[i] = int64_t(i % 11) - 5;
+    expected += a[i] * b[i];
+  }
+
+  EXPECT_EQ(expected, a * b);
+}
+
+TEST(TDynamicVector, can_evaluate_compound_expression)
+{
+  const size_t n = 600;
+  TDynamicVector<double> a(n), b(n), c(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    a[i] = double(i);
+    b[i] = double(i % 7);
+    c[i] = double(i % 3);
+  }
+  TDynamicVector<double> r = a + b - c * 2.0;
+
+  for (size_t i = 0; i < n; i++)
+    ASSERT_EQ(a[i] + b[i] - c[i] * 2.0, r[i]);
+}
+
+TEST(TDynamicVector, assign_expression_of_equal_size_keeps_memory)
+{
+  TDynamicVector<int> a(300), b(300), r(300);
+  for (size_t i = 0; i < 300; i++)
+  {
+    a[i] = int(i);
+    b[i] = 1;
+  }
+  const int* mem = r.data();
+  r = 2 * a + b;
+
+  EXPECT_EQ(mem, r.data());
+  EXPECT_EQ(599, r[299]);
+}
+
+TEST(TDynamicVector, can_assign_expression_containing_itself)
+{
+  TDynamicVector<int> a(300), b(300);
+  for (size_t i = 0; i < 300; i++)
+  {
+    a[i] = int(i);
+    b[i] = 2;
+  }
+  a = (a - b) * 3 + a;
+
+  EXPECT_EQ(-6, a[0]);
+  EXPECT_EQ((299 - 2) * 3 + 299, a[299]);
+}
+
+TEST(TDynamicVector, can_get_element_of_expression)
+{
+  int x[] = { 1, 2, 3 }, y[] = { 4, 5, 6 };
+  TDynamicVector<int> a(x, 3), b(y, 3);
+
+  EXPECT_EQ(8, (a + b + 1)[1]);
+}
+
+TEST(TDynamicVector, can_multiply_expressions)
+{
+  int x[] = { 1, 2, 3 }, y[] = { 4, 5, 6 };
+  TDynamicVector<int> a(x, 3), b(y, 3);
+
+  EXPECT_EQ(5 * 5 + 7 * 7 + 9 * 9, (a + b) * (b + a + a - a));
+}
+
+TEST(TDynamicVector, cant_combine_expressions_with_not_equal_size)
+{
+  TDynamicVector<int> a(3), b(3), c(4);
+
+  ASSERT_ANY_THROW(a + b - c);
+}
+
+TEST(TDynamicVector, can_update_vector_in_place)
+{
+  int x[] = { 1, 2, 3 }, y[] = { 4, 5, 6 };
+  TDynamicVector<int> a(x, 3), b(y, 3);
+  const int* mem = a.data();
+  a += b;
+  a -= b + b;
+  a *= 3;
+  a += 1;
+  a -= 2;
+
+  EXPECT_EQ(mem, a.data());
+  EXPECT_EQ((1 - 4) * 3 - 1, a[0]);
+  EXPECT_EQ((3 - 6) * 3 - 1, a[2]);
+}
+
+TEST(TDynamicVector, can_add_scaled_vector_in_place)
+{
+  TDynamicVector<double> x(301), y(301);
+  for (size_t i = 0; i < 301; i++)
+  {
+    x[i] = double(i);
+    y[i] = 1;
+  }
+  y += 2.0 * x;
+  y -= x * 0.5;
+  axpy(4.0, x, y);
+  y += 2.0 * (x + x);
+
+  for (size_t i = 0; i < 301; i++)
+    ASSERT_DOUBLE_EQ(1 + 9.5 * double(i), y[i]);
+}
+
+TEST(TDynamicVector, cant_update_vector_with_not_equal_size)
+{
+  TDynamicVector<int> a(3), b(4);
+
+  ASSERT_ANY_THROW(a += b);
+  ASSERT_ANY_THROW(a -= 2 * b);
+}
+
+TEST(TDynamicVector, arithmetic_with_temporary_reuses_its_memory)
+{
+  int x[] = { 1, 2, 3 }, y[] = { 4, 5, 6 };
+  TDynamicVector<int> a(x, 3), b(y, 3), t(a), u(b);
+  const int* mem = t.data();
+  const int* umem = u.data();
+  TDynamicVector<int> r = std::move(t) + a * 2 - b + 1;
+  TDynamicVector<int> s = a - std::move(u);
+
+  EXPECT_EQ(mem, r.data());
+  EXPECT_EQ(umem, s.data());
+  EXPECT_EQ(1 * 3 - 4 + 1, r[0]);
+  EXPECT_EQ(3 * 3 - 6 + 1, r[2]);
+  EXPECT_EQ(-3, s[0]);
+  EXPECT_EQ(-3, s[2]);
 }
 
+namespace
+{
+  // распределитель, считающий занятые блоки памяти
+  template<typename T>
+  struct TCountingAllocator
+  {
+    typedef T value_type;
+    int* blocks;
+
+    TCountingAllocator(int* b = nullptr) : blocks(b) {}
+    template<typename U>
+    TCountingAllocator(const TCountingAllocator<U>& a) : blocks(a.blocks) {}
+
+    T* allocate(size_t n)
+    {
+      if (blocks != nullptr)
+        ++*blocks;
+      return std::allocator<T>().allocate(n);
+    }
+    void deallocate(T* p, size_t n)
+    {
+      if (blocks != nullptr)
+        --*blocks;
+      std::allocator<T>().deallocate(p, n);
+    }
+  };
+  template<typename T, typename U>
+  bool operator==(const TCountingAllocator<T>& a, const TCountingAllocator<U>& b) { return a.blocks == b.blocks; }
+  template<typename T, typename U>
+  bool operator!=(const TCountingAllocator<T>& a, const TCountingAllocator<U>& b) { return a.blocks != b.blocks; }
+}
+
+TEST(TDynamicVector, allocates_memory_through_allocator)
+{
+  typedef TCountingAllocator<int> A;
+  int blocks = 0;
+  {
+    TDynamicVector<int, A> a(5, A(&blocks)), b(a);
+    EXPECT_EQ(2, blocks);
+    TDynamicVector<int, A> c(a + b * 2, A(&blocks));
+    EXPECT_EQ(3, blocks);
+    b = TDynamicVector<int, A>(7, A(&blocks)) + 1;
+    c = b - 1;
+    EXPECT_EQ(7u, c.size());
+    EXPECT_EQ(3, blocks);
+  }
+  EXPECT_EQ(0, blocks);
+}
+
+TEST(TDynamicVector, memory_is_aligned)
+{
+  TDynamicVector<char> a(3);
+  TDynamicVector<double> b(5), c(b + b);
+
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(a.data()) % MEMORY_ALIGNMENT);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(b.data()) % MEMORY_ALIGNMENT);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(c.data()) % MEMORY_ALIGNMENT);
+}
+
+TEST(TDynamicVector, can_create_uninitialized_vector)
+{
+  TDynamicVector<double> v(1000, uninitialized);
+  for (size_t i = 0; i < v.size(); i++)
+    v[i] = double(i);
+
+  EXPECT_EQ(1000u, v.size());
+  EXPECT_EQ(999.0, v[999]);
+  ASSERT_ANY_THROW(TDynamicVector<double>(0, uninitialized));
+}
+
+TEST(TDynamicVector, large_vector_is_zero_initialized)
+{
+  {
+    // освобожденная память может достаться следующему вектору
+    TDynamicVector<double> a(1000000, uninitialized);
+    for (size_t i = 0; i < a.size(); i++)
+      a[i] = 1.0;
+  }
+  TDynamicVector<double> v(1000000);
+  for (size_t i = 0; i < v.size(); i += 4099)
+    ASSERT_EQ(0.0, v[i]);
+  EXPECT_EQ(0.0, v[v.size() - 1]);
+}
+
+TEST(TDynamicVector, large_copy_is_equal_to_source)
+{
+  // больше порога потокового копирования, размер не кратен 64 байтам
+  const size_t n = (STREAM_COPY_BYTES / sizeof(int)) + 13;
+  TDynamicVector<int> a(n, uninitialized);
+  for (size_t i = 0; i < n; i++)
+    a[i] = int(i * 2654435761u);
+  TDynamicVector<int> b(a), c(5);
+  c = a;
+
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a, c);
+  b[n - 1]++;
+  EXPECT_NE(a, b);
+}
+
+TEST(TDynamicVector, compare_floating_point_vectors_by_value)
+{
+  TDynamicVector<double> a(2), b(2);
+  a[0] = 0.0;
+  b[0] = -0.0;
+
+  EXPECT_EQ(a, b);
+  a[1] = b[1] = std::numeric_limits<double>::quiet_NaN();
+  EXPECT_NE(a, b);
+}
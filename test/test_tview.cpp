@@ -0,0 +1,161 @@
+#include "tmatrix.h"
+
+#include <gtest.h>
+
+typedef TDynamicMatrix<double, TContiguousStorage<double>> TMatrix;
+
+TEST(TVectorView, slice_refers_to_vector_memory)
+{
+  TDynamicVector<int> v(10);
+  TVectorView<int> s = v.slice(1, 4, 2);
+  s[3] = 5;
+
+  EXPECT_EQ(5, v[7]);
+  EXPECT_EQ(4u, s.size());
+}
+
+TEST(TVectorView, throws_when_slice_is_out_of_vector)
+{
+  TDynamicVector<int> v(10);
+
+  ASSERT_ANY_THROW(v.slice(0, 6, 2));
+  ASSERT_ANY_THROW(v.slice(10, 1));
+  ASSERT_ANY_THROW(v.slice(0, 0));
+  ASSERT_NO_THROW(v.slice(1, 5, 2));
+}
+
+TEST(TVectorView, can_use_strided_view_in_expressions)
+{
+  TDynamicVector<int> v(600), w(300);
+  for (size_t i = 0; i < 600; i++)
+    v[i] = int(i);
+  for (size_t i = 0; i < 300; i++)
+    w[i] = 1;
+  TDynamicVector<int> r = v.slice(1, 300, 2) + w;
+
+  EXPECT_EQ(2, r[0]);
+  EXPECT_EQ(600, r[299]);
+  EXPECT_EQ(89700, v.slice(0, 300, 2) * w);
+}
+
+TEST(TVectorView, assignment_writes_through_strided_view)
+{
+  TDynamicVector<int> v(600), w(300);
+  for (size_t i = 0; i < 300; i++)
+    w[i] = int(i);
+  v.slice(0, 300, 2) = w * 2;
+  v.slice(0, 300, 2) += w;
+  v.slice(1, 300, 2) = v.slice(0, 300, 2);
+
+  EXPECT_EQ(3 * 299, v[598]);
+  EXPECT_EQ(3 * 299, v[599]);
+  EXPECT_EQ(3, v[3]);
+}
+
+TEST(TMatrixView, row_and_column_views_refer_to_matrix)
+{
+  TMatrix m(5);
+  m.row_view(1) = m.row_view(1) + 1.0;
+  m.col_view(3) *= 2.0;
+
+  EXPECT_EQ(2, m[1][3]);
+  EXPECT_EQ(1, m[1][4]);
+  EXPECT_EQ(0, m[2][3]);
+}
+
+TEST(TMatrixView, can_view_row_of_row_storage)
+{
+  TDynamicMatrix<int> m(4);
+  const TDynamicMatrix<int>& cm = m;
+  m.row_view(2)[1] = 3;
+
+  EXPECT_EQ(3, m[2][1]);
+  EXPECT_EQ(3, cm.row_view(2)[1]);
+}
+
+TEST(TMatrixView, column_view_in_matrix_vector_product)
+{
+  const size_t n = 20;
+  TMatrix a(n), b(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    a[i][i] = 2;
+    b[i][7] = double(i);
+  }
+  TDynamicVector<double> r = a * b.col_view(7);
+
+  EXPECT_EQ(38, r[19]);
+}
+
+TEST(TMatrixView, submatrix_refers_to_matrix)
+{
+  TMatrix m(6);
+  TMatrixView<double> s = m.submatrix(2, 3, 3);
+  s[0][0] = 1;
+  s.at(2, 2) = 2;
+
+  EXPECT_EQ(1, m[2][3]);
+  EXPECT_EQ(2, m[4][5]);
+  ASSERT_ANY_THROW(m.submatrix(4, 0, 3));
+  ASSERT_ANY_THROW(s.at(3, 0));
+}
+
+TEST(TMatrixView, can_copy_submatrix_to_matrix)
+{
+  TMatrix m(6);
+  for (size_t i = 0; i < 6; i++)
+    for (size_t j = 0; j < 6; j++)
+      m[i][j] = double(i * 6 + j);
+  TMatrix b = m.submatrix(1, 2, 3);
+  TMatrix c(3);
+  c += m.submatrix(0, 0, 3) * 2.0;
+
+  EXPECT_EQ(3u, b.size());
+  EXPECT_EQ(8, b[0][0]);
+  EXPECT_EQ(22, b[2][2]);
+  EXPECT_EQ(2 * 14, c[2][2]);
+}
+
+TEST(TMatrixView, overlapping_block_copy_is_correct)
+{
+  TMatrix m(5);
+  for (size_t i = 0; i < 5; i++)
+    for (size_t j = 0; j < 5; j++)
+      m[i][j] = double(i * 5 + j);
+  TMatrix e = m.submatrix(0, 0, 4);
+  m.submatrix(1, 1, 4) = m.submatrix(0, 0, 4);
+
+  EXPECT_EQ(e, TMatrix(m.submatrix(1, 1, 4)));
+}
+
+TEST(TMatrixView, block_product_updates_matrix_in_place)
+{
+  const size_t n = 160, h = n / 2;
+  TMatrix a(n), b(n), c(n);
+  for (size_t i = 0; i < n; i++)
+    for (size_t j = 0; j < n; j++)
+    {
+      a[i][j] = double((i + 2 * j) % 7) - 3;
+      b[i][j] = double((3 * i + j) % 5) - 2;
+    }
+  TMatrix ab = a * b;
+  // C = A * B по блокам 2 x 2
+  for (size_t i = 0; i < n; i += h)
+    for (size_t j = 0; j < n; j += h)
+      for (size_t k = 0; k < n; k += h)
+        c.submatrix(i, j, h) += a.submatrix(i, k, h) * b.submatrix(k, j, h);
+
+  EXPECT_EQ(ab, c);
+}
+
+TEST(TMatrixView, product_overlapping_destination_is_correct)
+{
+  TMatrix a(4);
+  for (size_t i = 0; i < 4; i++)
+    for (size_t j = 0; j < 4; j++)
+      a[i][j] = double(i + j);
+  TMatrix s = TMatrix(a.submatrix(0, 0, 2)) * TMatrix(a.submatrix(0, 0, 2));
+  a.submatrix(0, 0, 2) = a.submatrix(0, 0, 2) * a.submatrix(0, 0, 2);
+
+  EXPECT_EQ(s, TMatrix(a.submatrix(0, 0, 2)));
+}